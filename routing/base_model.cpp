@@ -1,6 +1,42 @@
 #include "base_model.h"
 
 #include <utility>
+#include <cstdlib>
+#include <cstdint>
+#include <stdexcept>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <limits>
+#include <thread>
+#include <atomic>
+#include <random>
+
+#ifdef MADRICH_X86_SIMD
+#include <immintrin.h>
+#endif
+
+
+//// Random
+
+
+Random::Random() {
+    std::random_device rd;
+    seed((uint64_t(rd()) << 32) | rd());
+}
+
+void Random::seed(uint64_t seed) {
+    for (auto &value : state) {  // splitmix64
+        seed += 0x9e3779b97f4a7c15;
+        uint64_t z = seed;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        value = z ^ (z >> 31);
+    }
+}
 
 
 //// Window
@@ -8,15 +44,114 @@
 
 Window::Window(std::tuple<time_t, time_t> window) : window(std::move(window)) {}
 
-time_t to_seconds(const std::string &time) {
-    std::tm t{};
-    std::istringstream ss(time);
-    ss >> std::get_time(&t, "%Y-%m-%dT%H:%M:%SZ");
-    return std::mktime(&t);
+Window::Window(const std::string &start_t, const std::string &end_t) {
+    window = std::tuple<time_t, time_t>(parse_time(start_t), parse_time(end_t));
+}
+
+/**
+ * Дней от 1970-01-01 до даты по григорианскому календарю (алгоритм days_from_civil Х. Хиннанта)
+ */
+int64_t days_from_civil(int64_t year, uint32_t month, uint32_t day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    auto year_of_era = uint32_t(year - era * 400);
+    uint32_t day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    uint32_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + int64_t(day_of_era) - 719468;
 }
 
-Window::Window(const std::string &start_t, const std::string &end_t) {
-    window = std::tuple<time_t, time_t>(to_seconds(start_t), to_seconds(end_t));
+/**
+ * count цифр с позиции pos; false, если там не цифры
+ */
+bool parse_digits(std::string_view str, std::size_t pos, std::size_t count, uint32_t &value) {
+    if (pos + count > str.size()) {
+        return false;
+    }
+    value = 0;
+    for (std::size_t i = pos; i < pos + count; ++i) {
+        auto digit = uint32_t(str[i] - '0');
+        if (digit > 9) {
+            return false;
+        }
+        value = value * 10 + digit;
+    }
+    return true;
+}
+
+time_t parse_time(std::string_view time) {
+    auto fail = [&time]() {
+        return std::invalid_argument("parse_time: bad ISO-8601 time '" + std::string(time) + "'");
+    };
+    uint32_t year, month, day, hour, minute, second;
+    if (time.size() < 19) {  // короче "YYYY-MM-DDThh:mm:ss": разделители ниже читаются без проверок
+        throw fail();
+    }
+    if (!parse_digits(time, 0, 4, year) || time[4] != '-' ||
+        !parse_digits(time, 5, 2, month) || time[7] != '-' ||
+        !parse_digits(time, 8, 2, day) || (time[10] != 'T' && time[10] != ' ') ||
+        !parse_digits(time, 11, 2, hour) || time[13] != ':' ||
+        !parse_digits(time, 14, 2, minute) || time[16] != ':' ||
+        !parse_digits(time, 17, 2, second)) {
+        throw fail();
+    }
+    static constexpr uint32_t month_days[] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+    if (month < 1 || month > 12 || day < 1 || day > month_days[month - 1] || (month == 2 && day == 29 && !leap) ||
+        hour > 23 || minute > 59 || second > 60) {
+        throw fail();
+    }
+
+    std::size_t pos = 19;
+    if (pos < time.size() && (time[pos] == '.' || time[pos] == ',')) {  // доли секунды
+        ++pos;
+        std::size_t begin = pos;
+        while (pos < time.size() && uint32_t(time[pos] - '0') <= 9) {
+            ++pos;
+        }
+        if (pos == begin) {
+            throw fail();
+        }
+    }
+
+    int64_t offset = 0;  // смещение пояса в секундах
+    if (pos < time.size() && time[pos] == 'Z') {
+        ++pos;
+    } else if (pos < time.size() && (time[pos] == '+' || time[pos] == '-')) {
+        int64_t sign = time[pos] == '-' ? -1 : 1;
+        uint32_t offset_hour, offset_minute = 0;
+        if (!parse_digits(time, pos + 1, 2, offset_hour)) {
+            throw fail();
+        }
+        pos += 3;
+        if (pos < time.size() && time[pos] == ':') {
+            ++pos;
+        }
+        if (pos < time.size()) {
+            if (!parse_digits(time, pos, 2, offset_minute)) {
+                throw fail();
+            }
+            pos += 2;
+        }
+        if (offset_hour > 23 || offset_minute > 59) {
+            throw fail();
+        }
+        offset = sign * int64_t(offset_hour * 3600 + offset_minute * 60);
+    }
+    if (pos != time.size()) {
+        throw fail();
+    }
+
+    int64_t days = days_from_civil(year, month, day);
+    return time_t(days * 86400 + int64_t(hour * 3600 + minute * 60 + second) - offset);
+}
+
+std::vector<Window> parse_windows(const std::vector<std::tuple<std::string, std::string>> &windows) {
+    std::vector<Window> ret;
+    ret.reserve(windows.size());
+    for (const auto &[start_t, end_t] : windows) {
+        ret.emplace_back(std::tuple<time_t, time_t>(parse_time(start_t), parse_time(end_t)));
+    }
+    return ret;
 }
 
 [[maybe_unused]] void Window::print() const {
@@ -48,68 +183,659 @@ Cost::Cost(float start, float second, float meter) : start(start), second(second
 //// Matrix
 
 
+constexpr char MATRIX_MAGIC[8] = "MADRICH";
+constexpr uint32_t MATRIX_VERSION = 1;
+static_assert(sizeof(MatrixFileHeader) % MATRIX_ALIGNMENT == 0);
+
+/**
+ * Размер блока с выравниванием по MATRIX_ALIGNMENT
+ */
+std::size_t aligned_size(std::size_t bytes) {
+    return (bytes + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT * MATRIX_ALIGNMENT;
+}
+
+/**
+ * Произведение без переполнения
+ * @return a * b; nullopt, если не влезает в size_t
+ */
+std::optional<std::size_t> checked_multiply(std::size_t a, std::size_t b) {
+    std::size_t ret;
+    if (__builtin_mul_overflow(a, b, &ret)) {
+        return std::nullopt;
+    }
+    return ret;
+}
+
+/**
+ * Плоский блок под count элементов, выровненный по MATRIX_ALIGNMENT
+ */
+template<typename T>
+std::shared_ptr<T[]> allocate_aligned(std::size_t count) {
+    std::size_t bytes = aligned_size(count * sizeof(T));
+    void *ptr = std::aligned_alloc(MATRIX_ALIGNMENT, bytes == 0 ? MATRIX_ALIGNMENT : bytes);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return std::shared_ptr<T[]>(static_cast<T *>(ptr), std::free);
+}
+
+/**
+ * Проверяем, что срез квадратный нужного размера
+ */
+template<typename T>
+void check_square(const std::vector<std::vector<T>> &matrix, uint32_t size) {
+    if (matrix.size() != size) {
+        throw std::invalid_argument("All matrix slices must have the same size");
+    }
+    for (const auto &row : matrix) {
+        if (row.size() != size) {
+            throw std::invalid_argument("Matrix must be square");
+        }
+    }
+}
+
+/**
+ * Параметры квантования для значений от min до max
+ */
+uint32_t quantization_scale(int64_t min, int64_t max) {
+    int64_t range = max - min;
+    return std::max<int64_t>(1, (range + UINT16_MAX - 1) / UINT16_MAX);
+}
+
+/**
+ * Квантованное значение, округление до ближайшего
+ */
+uint16_t quantize(int64_t value, int64_t offset, uint32_t scale) {
+    return static_cast<uint16_t>((value - offset + scale / 2) / scale);
+}
+
+/**
+ * Квантование строки: параметры строки по ее минимуму и максимуму, затем сами ячейки
+ */
+void quantize_row(const time_t *times, const int *distances, uint32_t size,
+                  QuantizedRow &row, uint16_t *time_cells, uint16_t *distance_cells) {
+    int64_t time_min = INT64_MAX, time_max = INT64_MIN;
+    int64_t distance_min = INT64_MAX, distance_max = INT64_MIN;
+    for (uint32_t j = 0; j < size; ++j) {
+        time_min = std::min<int64_t>(time_min, times[j]);
+        time_max = std::max<int64_t>(time_max, times[j]);
+        distance_min = std::min<int64_t>(distance_min, distances[j]);
+        distance_max = std::max<int64_t>(distance_max, distances[j]);
+    }
+    row.time_offset = time_min;
+    row.distance_offset = int(distance_min);
+    row.time_scale = quantization_scale(time_min, time_max);
+    row.distance_scale = quantization_scale(distance_min, distance_max);
+    for (uint32_t j = 0; j < size; ++j) {
+        time_cells[j] = quantize(times[j], row.time_offset, row.time_scale);
+        distance_cells[j] = quantize(distances[j], row.distance_offset, row.distance_scale);
+    }
+}
+
+template<typename Time, typename Distance>
+void Matrix::fill_slice(uint32_t k, Time time, Distance distance) {
+    std::size_t count = std::size_t(size) * size;
+    if (layout == MatrixLayout::Flat) {
+        std::shared_ptr<time_t[]> time_block = allocate_aligned<time_t>(count);
+        std::shared_ptr<int[]> distance_block = allocate_aligned<int>(count);
+        for (uint32_t i = 0; i < size; ++i) {
+            for (uint32_t j = 0; j < size; ++j) {
+                time_block[std::size_t(i) * size + j] = time(i, j);
+                distance_block[std::size_t(i) * size + j] = distance(i, j);
+            }
+        }
+        travel_time[k] = std::move(time_block);
+        this->distance[k] = std::move(distance_block);
+    } else if (layout == MatrixLayout::Interleaved) {
+        std::shared_ptr<MatrixCell[]> cell_block = allocate_aligned<MatrixCell>(count);
+        for (uint32_t i = 0; i < size; ++i) {
+            for (uint32_t j = 0; j < size; ++j) {
+                cell_block[std::size_t(i) * size + j] = {int32_t(time(i, j)), int32_t(distance(i, j))};
+            }
+        }
+        cells[k] = std::move(cell_block);
+    } else if (layout == MatrixLayout::Symmetric) {
+        std::size_t triangle = std::size_t(size) * (size + 1) / 2;
+        std::shared_ptr<time_t[]> time_block = allocate_aligned<time_t>(triangle);
+        std::shared_ptr<int[]> distance_block = allocate_aligned<int>(triangle);
+        std::size_t cell = 0;
+        for (uint32_t i = 0; i < size; ++i) {
+            for (uint32_t j = i; j < size; ++j, ++cell) {
+                if (time(i, j) != time(j, i) || distance(i, j) != distance(j, i)) {
+                    throw std::invalid_argument("Matrix: symmetric layout for asymmetric matrix");
+                }
+                time_block[cell] = time(i, j);
+                distance_block[cell] = distance(i, j);
+            }
+        }
+        travel_time[k] = std::move(time_block);
+        this->distance[k] = std::move(distance_block);
+    } else {
+        std::shared_ptr<uint16_t[]> time_block = allocate_aligned<uint16_t>(count);
+        std::shared_ptr<uint16_t[]> distance_block = allocate_aligned<uint16_t>(count);
+        std::shared_ptr<QuantizedRow[]> row_block = allocate_aligned<QuantizedRow>(size);
+        std::vector<time_t> times(size);
+        std::vector<int> distances(size);
+        for (uint32_t i = 0; i < size; ++i) {
+            for (uint32_t j = 0; j < size; ++j) {
+                times[j] = time(i, j);
+                distances[j] = distance(i, j);
+            }
+            std::size_t row = std::size_t(i) * size;
+            quantize_row(times.data(), distances.data(), size, row_block[i],
+                         time_block.get() + row, distance_block.get() + row);
+        }
+        quantized_time[k] = std::move(time_block);
+        quantized_distance[k] = std::move(distance_block);
+        rows[k] = std::move(row_block);
+    }
+}
+
+template<typename Time, typename Distance>
+void Matrix::fill(uint32_t slices, Time time, Distance distance) {
+    slice_count = slices;
+    if (layout == MatrixLayout::Flat || layout == MatrixLayout::Symmetric) {
+        travel_time.resize(slices);
+        this->distance.resize(slices);
+    } else if (layout == MatrixLayout::Interleaved) {
+        cells.resize(slices);
+    } else {
+        quantized_time.resize(slices);
+        quantized_distance.resize(slices);
+        rows.resize(slices);
+    }
+
+    std::vector<time_t> later;  // поправленное время следующего среза
+    for (uint32_t step = 0; step < slices; ++step) {
+        uint32_t k = interpolation ? slices - 1 - step : step;
+        auto slice_distance = [&distance, k](uint32_t i, uint32_t j) { return distance(k, i, j); };
+        if (!interpolation) {
+            fill_slice(k, [&time, k](uint32_t i, uint32_t j) { return time(k, i, j); }, slice_distance);
+            continue;
+        }
+
+        std::vector<time_t> current(std::size_t(size) * size);
+        for (uint32_t i = 0; i < size; ++i) {
+            for (uint32_t j = 0; j < size; ++j) {
+                std::size_t cell = std::size_t(i) * size + j;
+                current[cell] = later.empty() ? time(k, i, j) : std::min<time_t>(time(k, i, j), later[cell] + discreteness);
+            }
+        }
+        fill_slice(k, [this, &current](uint32_t i, uint32_t j) { return current[std::size_t(i) * size + j]; },
+                   slice_distance);
+        later = std::move(current);
+    }
+    index_slices();
+}
+
+void Matrix::index_slices() {
+    buckets.clear();
+    if (slice_count <= 1 || discreteness == 0) {
+        return;
+    }
+    bucket_shift = 0;
+    while ((uint64_t(2) << bucket_shift) <= discreteness) {
+        ++bucket_shift;  // самая широкая корзина 2^k <= discreteness
+    }
+    uint64_t period = uint64_t(slice_count) * discreteness;
+    std::size_t number = (period + (uint64_t(1) << bucket_shift) - 1) >> bucket_shift;
+    buckets.resize(number);
+    for (std::size_t b = 0; b < number; ++b) {
+        uint64_t begin = uint64_t(b) << bucket_shift;
+        auto matrix = static_cast<uint32_t>(begin / discreteness);
+        buckets[b].slice = matrix;
+        buckets[b].boundary = matrix + 1 < slice_count ? uint64_t(matrix + 1) * discreteness : UINT64_MAX;
+    }
+}
+
 Matrix::Matrix(
         std::string profile,
-        std::vector<std::vector<int>> distance,
-        std::vector<std::vector<time_t>> travel_time
+        const std::vector<std::vector<int>> &distance,
+        const std::vector<std::vector<time_t>> &travel_time,
+        MatrixLayout layout
 )
-        : profile(std::move(profile)), distance({std::move(distance)}), travel_time({std::move(travel_time)}) {}
+        : layout(layout), size(distance.size()), profile(std::move(profile)) {
+    check_square(distance, size);
+    check_square(travel_time, size);
+    fill(1,
+         [&travel_time](uint32_t, uint32_t i, uint32_t j) { return travel_time[i][j]; },
+         [&distance](uint32_t, uint32_t i, uint32_t j) { return distance[i][j]; });
+}
 
 Matrix::Matrix(
         std::string profile,
-        std::vector<std::vector<std::vector<int>>> distance,
-        std::vector<std::vector<std::vector<time_t>>> travel_time,
+        const std::vector<std::vector<std::vector<int>>> &distance,
+        const std::vector<std::vector<std::vector<time_t>>> &travel_time,
         uint32_t discreteness,
         time_t start_time,
-        time_t end_time
+        time_t end_time,
+        MatrixLayout layout,
+        bool interpolation
 )
-        : profile(std::move(profile)), distance(std::move(distance)), travel_time(std::move(travel_time)),
-          discreteness(discreteness), start_time(start_time), end_time(end_time) {}
+        : layout(layout), discreteness(discreteness), start_time(start_time), end_time(end_time),
+          interpolation(interpolation), profile(std::move(profile)) {
+    if (distance.size() != travel_time.size()) {
+        throw std::invalid_argument("Distance and time matrices must have the same number of slices");
+    }
+    size = distance.empty() ? 0 : distance[0].size();
+    for (std::size_t k = 0; k < distance.size(); ++k) {
+        check_square(distance[k], size);
+        check_square(travel_time[k], size);
+    }
+    fill(distance.size(),
+         [&travel_time](uint32_t k, uint32_t i, uint32_t j) { return travel_time[k][i][j]; },
+         [&distance](uint32_t k, uint32_t i, uint32_t j) { return distance[k][i][j]; });
+}
+
+uint64_t Matrix::next_identity() {
+    static std::atomic<uint64_t> counter = 0;
+    return ++counter;
+}
+
+Matrix::Matrix(const Matrix &matrix, MatrixLayout layout, bool interpolation)
+        : layout(layout), size(matrix.size), discreteness(matrix.discreteness), start_time(matrix.start_time),
+          end_time(matrix.end_time), interpolation(interpolation), profile(matrix.profile) {
+    fill(matrix.slices(),
+         [&matrix](uint32_t k, uint32_t i, uint32_t j) { return matrix.cell_time(k, i, j); },
+         [&matrix](uint32_t k, uint32_t i, uint32_t j) { return matrix.cell_distance(k, i, j); });
+}
+
+Matrix::Matrix(std::string profile, uint32_t size, const MatrixRow &row, MatrixLayout layout, uint32_t threads)
+        : layout(layout), size(size), slice_count(1), profile(std::move(profile)) {
+    fill_rows(row, threads);
+}
+
+Matrix::Matrix(std::string profile, uint32_t size, uint32_t slices, const MatrixRow &row,
+               uint32_t discreteness, time_t start_time, time_t end_time,
+               MatrixLayout layout, bool interpolation, uint32_t threads)
+        : layout(layout), size(size), slice_count(slices), discreteness(discreteness), start_time(start_time),
+          end_time(end_time), interpolation(interpolation), profile(std::move(profile)) {
+    fill_rows(row, threads);
+    index_slices();
+}
+
+void Matrix::fill_rows(const MatrixRow &row, uint32_t threads) {
+    std::size_t count = std::size_t(size) * size;
+    std::vector<time_t *> time_blocks(slice_count);
+    std::vector<int *> distance_blocks(slice_count);
+    std::vector<MatrixCell *> cell_blocks(slice_count);
+    std::vector<uint16_t *> time_cells(slice_count);
+    std::vector<uint16_t *> distance_cells(slice_count);
+    std::vector<QuantizedRow *> row_blocks(slice_count);
+    for (uint32_t k = 0; k < slice_count; ++k) {
+        if (layout == MatrixLayout::Flat || layout == MatrixLayout::Symmetric) {
+            std::size_t cells_count = layout == MatrixLayout::Flat ? count : std::size_t(size) * (size + 1) / 2;
+            std::shared_ptr<time_t[]> times = allocate_aligned<time_t>(cells_count);
+            std::shared_ptr<int[]> distances = allocate_aligned<int>(cells_count);
+            time_blocks[k] = times.get();
+            distance_blocks[k] = distances.get();
+            travel_time.push_back(std::move(times));
+            distance.push_back(std::move(distances));
+        } else if (layout == MatrixLayout::Interleaved) {
+            std::shared_ptr<MatrixCell[]> block = allocate_aligned<MatrixCell>(count);
+            cell_blocks[k] = block.get();
+            cells.push_back(std::move(block));
+        } else {
+            std::shared_ptr<uint16_t[]> times = allocate_aligned<uint16_t>(count);
+            std::shared_ptr<uint16_t[]> distances = allocate_aligned<uint16_t>(count);
+            std::shared_ptr<QuantizedRow[]> row_params = allocate_aligned<QuantizedRow>(size);
+            time_cells[k] = times.get();
+            distance_cells[k] = distances.get();
+            row_blocks[k] = row_params.get();
+            quantized_time.push_back(std::move(times));
+            quantized_distance.push_back(std::move(distances));
+            rows.push_back(std::move(row_params));
+        }
+    }
+
+    constexpr uint32_t ROWS_PER_TASK = 16;  // строки раздаются пачками, Symmetric к концу короче
+    bool direct = layout == MatrixLayout::Flat && slice_count == 1;  // строка сразу в срез, без буфера
+    std::atomic<uint32_t> next = 0;
+    auto work = [&]() {
+        std::vector<time_t> times(direct ? 0 : std::size_t(slice_count) * size);  // буфер строки во всех срезах
+        std::vector<int> distances(times.size());
+        for (uint32_t begin = next.fetch_add(ROWS_PER_TASK); begin < size; begin = next.fetch_add(ROWS_PER_TASK)) {
+            for (uint32_t i = begin; i < std::min(begin + ROWS_PER_TASK, size); ++i) {
+                std::size_t offset = std::size_t(i) * size;
+                if (direct) {
+                    row(i, time_blocks[0] + offset, distance_blocks[0] + offset);
+                    continue;
+                }
+                row(i, times.data(), distances.data());
+                for (uint32_t k = 0; k < slice_count; ++k) {
+                    const time_t *slice_times = times.data() + std::size_t(k) * size;
+                    const int *slice_distances = distances.data() + std::size_t(k) * size;
+                    if (layout == MatrixLayout::Flat) {
+                        std::copy(slice_times, slice_times + size, time_blocks[k] + offset);
+                        std::copy(slice_distances, slice_distances + size, distance_blocks[k] + offset);
+                    } else if (layout == MatrixLayout::Interleaved) {
+                        for (uint32_t j = 0; j < size; ++j) {
+                            cell_blocks[k][offset + j] = {int32_t(slice_times[j]), int32_t(slice_distances[j])};
+                        }
+                    } else if (layout == MatrixLayout::Symmetric) {
+                        std::size_t cell = packed(i, i);
+                        std::copy(slice_times + i, slice_times + size, time_blocks[k] + cell);
+                        std::copy(slice_distances + i, slice_distances + size, distance_blocks[k] + cell);
+                    } else {
+                        quantize_row(slice_times, slice_distances, size, row_blocks[k][i],
+                                     time_cells[k] + offset, distance_cells[k] + offset);
+                    }
+                }
+            }
+        }
+    };
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::vector<std::thread> workers;
+    for (uint32_t t = 1; t < threads; ++t) {
+        workers.emplace_back(work);
+    }
+    work();  // текущий поток тоже считает
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+Matrix::Matrix(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error("Can't open matrix file " + path + ": " + strerror(errno));
+    }
+    struct stat st{};
+    if (fstat(fd, &st) == -1 || std::size_t(st.st_size) < sizeof(MatrixFileHeader)) {
+        close(fd);
+        throw std::runtime_error("Bad matrix file " + path);
+    }
+    std::size_t length = st.st_size;
+    void *addr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);  // отображение живет и без дескриптора
+    if (addr == MAP_FAILED) {
+        throw std::runtime_error("Can't map matrix file " + path + ": " + strerror(errno));
+    }
+    madvise(addr, length, MADV_RANDOM);  // обращения к матрице случайные, readahead только мешает
+    std::shared_ptr<const std::byte> mapping(
+            static_cast<const std::byte *>(addr),
+            [length](const std::byte *ptr) { munmap(const_cast<std::byte *>(ptr), length); }
+    );
+
+    MatrixFileHeader header{};
+    std::memcpy(&header, mapping.get(), sizeof(header));
+    if (std::memcmp(header.magic, MATRIX_MAGIC, sizeof(MATRIX_MAGIC)) != 0 || header.version != MATRIX_VERSION) {
+        throw std::runtime_error("Unknown matrix file format " + path);
+    }
+    if (header.slices == 0 || (header.discreteness == 0 && header.slices > 1)) {  // по ним ищется срез
+        throw std::runtime_error("Bad matrix file header " + path);
+    }
+    // заголовок может быть испорчен: размеры считаются без переполнений и сверяются с длиной файла
+    std::size_t count = std::size_t(header.dimension) * header.dimension;  // uint32 * uint32 влезает
+    std::optional time_cells = checked_multiply(count, sizeof(time_t));
+    std::optional distance_cells = checked_multiply(count, sizeof(int));
+    if (!time_cells || !distance_cells || time_cells.value() > length || distance_cells.value() > length) {
+        throw std::runtime_error("Truncated matrix file " + path);
+    }
+    std::size_t time_bytes = aligned_size(time_cells.value());
+    std::size_t distance_bytes = aligned_size(distance_cells.value());
+    std::optional slices_bytes = checked_multiply(header.slices, time_bytes + distance_bytes);
+    if (!slices_bytes || length - sizeof(header) < slices_bytes.value()) {
+        throw std::runtime_error("Truncated matrix file " + path);
+    }
+
+    profile = std::string(header.profile, strnlen(header.profile, sizeof(header.profile)));
+    size = header.dimension;
+    slice_count = header.slices;
+    discreteness = header.discreteness;
+    start_time = header.start_time;
+    end_time = header.end_time;
+    interpolation = header.interpolation != 0;
+    std::size_t offset = sizeof(header);
+    for (uint32_t i = 0; i < header.slices; ++i) {  // срезы держат отображение живым
+        travel_time.emplace_back(mapping, reinterpret_cast<const time_t *>(mapping.get() + offset));
+        offset += time_bytes;
+        distance.emplace_back(mapping, reinterpret_cast<const int *>(mapping.get() + offset));
+        offset += distance_bytes;
+    }
+    index_slices();
+}
+
+void Matrix::save(const std::string &path) const {
+    if (layout != MatrixLayout::Flat) {
+        throw std::invalid_argument("Only flat matrices can be saved");
+    }
+    if (slices() == 0 || (discreteness == 0 && slices() > 1)) {  // такой заголовок загрузка не примет
+        throw std::invalid_argument("Matrix without slices or discreteness can't be saved");
+    }
+    MatrixFileHeader header{};
+    std::memcpy(header.magic, MATRIX_MAGIC, sizeof(MATRIX_MAGIC));
+    header.version = MATRIX_VERSION;
+    header.dimension = size;
+    header.slices = slices();
+    header.discreteness = discreteness;
+    header.start_time = start_time;
+    header.end_time = end_time;
+    header.interpolation = interpolation;
+    if (profile.size() >= sizeof(header.profile)) {
+        throw std::invalid_argument("Matrix profile is too long: " + profile);
+    }
+    std::memcpy(header.profile, profile.data(), profile.size());
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Can't create matrix file " + path);
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    std::size_t count = std::size_t(size) * size;
+    const char padding[MATRIX_ALIGNMENT] = {};
+    for (uint32_t i = 0; i < slices(); ++i) {
+        file.write(reinterpret_cast<const char *>(travel_time[i].get()), count * sizeof(time_t));
+        file.write(padding, aligned_size(count * sizeof(time_t)) - count * sizeof(time_t));
+        file.write(reinterpret_cast<const char *>(distance[i].get()), count * sizeof(int));
+        file.write(padding, aligned_size(count * sizeof(int)) - count * sizeof(int));
+    }
+    if (!file) {
+        throw std::runtime_error("Can't write matrix file " + path);
+    }
+}
+
+std::size_t Matrix::memory_usage() const {
+    std::size_t count = std::size_t(size) * size;
+    if (layout == MatrixLayout::Interleaved) {
+        return std::size_t(slices()) * count * sizeof(MatrixCell);
+    }
+    if (layout == MatrixLayout::Quantized) {
+        return std::size_t(slices()) * (count * 2 * sizeof(uint16_t) + size * sizeof(QuantizedRow));
+    }
+    if (layout == MatrixLayout::Symmetric) {
+        count = std::size_t(size) * (size + 1) / 2;
+    }
+    return std::size_t(slices()) * count * (sizeof(int) + sizeof(time_t));
+}
+
+bool cpu_has_avx2() {
+#ifdef MADRICH_X86_SIMD
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+#ifdef MADRICH_X86_SIMD
+
+/**
+ * Сбор по 8 ячеек строки Flat: расстояния одним gather, время (int64) двумя
+ * @return сколько ячеек собрано, хвост добирается обычным циклом
+ */
+__attribute__((target("avx2")))
+std::size_t gather_flat(const time_t *time_row, const int *distance_row,
+                        const uint32_t *dst, std::size_t count, time_t *times, int *distances) {
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+        __m256i distance = _mm256_i32gather_epi32(distance_row, index, sizeof(int));
+        __m256i time_low = _mm256_i32gather_epi64(reinterpret_cast<const long long *>(time_row),
+                                                  _mm256_castsi256_si128(index), sizeof(time_t));
+        __m256i time_high = _mm256_i32gather_epi64(reinterpret_cast<const long long *>(time_row),
+                                                   _mm256_extracti128_si256(index, 1), sizeof(time_t));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(distances + i), distance);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(times + i), time_low);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(times + i + 4), time_high);
+    }
+    return i;
+}
+
+/**
+ * Сбор по 8 ячеек строки Interleaved: время и расстояние лежат парами int32
+ */
+__attribute__((target("avx2")))
+std::size_t gather_interleaved(const MatrixCell *row, const uint32_t *dst, std::size_t count,
+                               time_t *times, int *distances) {
+    const int *base = reinterpret_cast<const int *>(row);
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i index = _mm256_slli_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i)), 1);
+        __m256i time = _mm256_i32gather_epi32(base, index, sizeof(int));
+        __m256i distance = _mm256_i32gather_epi32(base + 1, index, sizeof(int));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(distances + i), distance);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(times + i), _mm256_cvtepi32_epi64(_mm256_castsi256_si128(time)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(times + i + 4),
+                            _mm256_cvtepi32_epi64(_mm256_extracti128_si256(time, 1)));
+    }
+    return i;
+}
+
+#endif
+
+void Matrix::get_one_to_many(uint32_t src,
+                             std::span<const uint32_t> dst,
+                             std::span<time_t> times,
+                             std::span<int> distances,
+                             time_t curr_time) const {
+    if (times.size() < dst.size() || distances.size() < dst.size()) {
+        throw std::invalid_argument("Matrix: output shorter than destinations");
+    }
+    if (expired(curr_time)) {
+        std::fill_n(times.begin(), dst.size(), -1);
+        std::fill_n(distances.begin(), dst.size(), -1);
+        return;
+    }
+
+    uint32_t matrix = slice(curr_time);
+    std::size_t row = std::size_t(src) * size;
+    std::size_t i = 0;
+#ifdef MADRICH_X86_SIMD
+    if (!interpolation && cpu_has_avx2()) {  // индексы gather знаковые 32-битные, но матриц на 2^30 точек не бывает
+        if (layout == MatrixLayout::Flat) {
+            i = gather_flat(travel_time[matrix].get() + row, distance[matrix].get() + row,
+                            dst.data(), dst.size(), times.data(), distances.data());
+        } else if (layout == MatrixLayout::Interleaved) {
+            i = gather_interleaved(cells[matrix].get() + row, dst.data(), dst.size(), times.data(), distances.data());
+        }
+    }
+#endif
+    for (; i < dst.size(); ++i) {
+        times[i] = interpolate(matrix, src, dst[i], curr_time, cell_time(matrix, src, dst[i]));
+        distances[i] = cell_distance(matrix, src, dst[i]);
+    }
+}
+
+bool Matrix::symmetric() const {
+    if (layout == MatrixLayout::Symmetric) {
+        return true;
+    }
+    for (uint32_t k = 0; k < slice_count; ++k) {
+        for (uint32_t i = 0; i < size; ++i) {
+            for (uint32_t j = i + 1; j < size; ++j) {
+                if (cell_time(k, i, j) != cell_time(k, j, i) || cell_distance(k, i, j) != cell_distance(k, j, i)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
 
 [[maybe_unused]] void Matrix::print() const {
-    printf("Matrix: %s, size: %zu\n", profile.c_str(), distance.size());
+    printf("Matrix: %s, size: %u, slices: %u\n", profile.c_str(), size, slices());
 }
 
-time_t Matrix::get_time(uint32_t src, uint32_t dst, time_t curr_time) const {
-    if (end_time < curr_time) { return -1; }
-    uint32_t matrix = start_time == 0 ? 0 : (curr_time - start_time) / discreteness;
-    return travel_time[matrix][src][dst];
+
+//// CostMatrix
+
+
+CostMatrix::CostMatrix(ptrMatrix matrix, const Cost &cost)
+        : matrix(std::move(matrix)), second(cost.second), meter(cost.meter) {
+    const Matrix &source = *this->matrix;
+    if (source.interpolated()) {
+        throw std::invalid_argument("CostMatrix: matrix with interpolation");
+    }
+    uint32_t size = source.dimension();
+    costs.resize(source.slices());
+    for (uint32_t k = 0; k < source.slices(); ++k) {
+        std::shared_ptr<float[]> block = allocate_aligned<float>(std::size_t(size) * size);
+        for (uint32_t i = 0; i < size; ++i) {
+            for (uint32_t j = 0; j < size; ++j) {
+                // та же формула, что и RvrpProblem::cost
+                block[std::size_t(i) * size + j] = float(source.cell_time(k, i, j)) * second
+                                                   + float(source.cell_distance(k, i, j)) * meter;
+            }
+        }
+        costs[k] = std::move(block);
+    }
+}
+
+std::size_t CostMatrix::memory_usage() const {
+    std::size_t size = matrix->dimension();
+    return costs.size() * size * size * sizeof(float);
+}
+
+
+//// Load
+
+
+Load::Load(uint32_t size) : count(size) {
+    if (size > MAX_VALUE_DIMENSION) {
+        throw std::invalid_argument("Load: dimension " + std::to_string(size) + " is over MAX_VALUE_DIMENSION");
+    }
+}
+
+Load::Load(const std::vector<int> &values) : Load(uint32_t(values.size())) {
+    std::copy(values.begin(), values.end(), this->values.begin());
+}
+
+Load &Load::operator+=(const Load &rhs) {
+    for (uint32_t i = 0; i < std::min(count, rhs.count); ++i) {
+        values[i] += rhs.values[i];
+    }
+    return *this;
 }
 
-int Matrix::get_distance(uint32_t src, uint32_t dst, time_t curr_time) const {
-    if (end_time < curr_time) { return -1; }
-    uint32_t matrix = start_time == 0 ? 0 : (curr_time - start_time) / discreteness;
-    return distance[matrix][src][dst];
+bool Load::operator==(const Load &rhs) const {
+    return std::equal(begin(), end(), rhs.begin(), rhs.end());
 }
 
 
 //// State
 
 
-State::State(time_t travel_time, int distance, float cost, std::optional<std::vector<int>> value)
-        : travel_time(travel_time), distance(distance), cost(cost), value(std::move(value)) {}
+State::State(time_t travel_time, int distance, float cost, std::optional<Load> value)
+        : travel_time(travel_time), distance(distance), cost(cost), value(value) {}
 
 [[maybe_unused]] void State::print() const {
     printf("State; travel time: %ld, distance: %d, cost: %f\n", travel_time, distance, cost);
 }
 
-std::optional<std::vector<int>> State::sum_values(const State &lt, const State &rt) {
-    if ((!lt.value.has_value()) && (!rt.value.has_value())) {
-        return std::nullopt;
-    } else if (lt.value.has_value() && !rt.value.has_value()) {
+std::optional<Load> State::sum_values(const State &lt, const State &rt) {
+    if (!rt.value) {
         return lt.value;
-    } else if (!lt.value.has_value() && rt.value.has_value()) {
+    }
+    if (!lt.value) {
         return rt.value;
-    } else {
-        int size = lt.value.value().size();
-        std::optional ret = std::vector<int>(size);
-        std::vector<int> ltv = lt.value.value();
-        std::vector<int> rtv = rt.value.value();
-        for (std::size_t i = 0; i < size; ++i) {
-            ret.value()[i] = ltv[i] + rtv[i];
-        }
-        return ret;
     }
+    Load ret = lt.value.value();
+    ret += rt.value.value();
+    return ret;
 }
 
 State State::operator+(const State &rhs) const {
@@ -120,7 +846,11 @@ State &State::operator+=(const State &rhs) {
     travel_time += rhs.travel_time;
     distance += rhs.distance;
     cost += rhs.cost;
-    value = sum_values(*this, rhs);
+    if (value && rhs.value) {
+        value.value() += rhs.value.value();
+    } else if (rhs.value) {
+        value = rhs.value;
+    }
     return *this;
 }
 
@@ -150,6 +880,45 @@ State State::operator-(const State &rhs) const {
 }
 
 
+//// SkillSet
+
+
+void SkillSet::set(uint32_t position) {
+    if (position < 64) {
+        bits |= uint64_t(1) << position;
+        return;
+    }
+    std::size_t word = position / 64 - 1;
+    if (overflow.size() <= word) {
+        overflow.resize(word + 1, 0);
+    }
+    overflow[word] |= uint64_t(1) << (position % 64);
+}
+
+bool SkillSet::covers_overflow(const SkillSet &required) const {
+    for (std::size_t i = 0; i < required.overflow.size(); ++i) {
+        uint64_t have = i < overflow.size() ? overflow[i] : 0;
+        if (required.overflow[i] & ~have) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+//// SkillRegistry
+
+
+SkillSet SkillRegistry::intern(const std::vector<std::string> &skills) {
+    SkillSet set;
+    for (const auto &skill : skills) {
+        auto [it, _] = positions.emplace(skill, uint32_t(positions.size()));
+        set.set(it->second);
+    }
+    return set;
+}
+
+
 //// Job
 
 
@@ -256,6 +1025,270 @@ bool Courier::operator==(const Courier &other) const {
 }
 
 
+Matrices share_matrices(std::map<std::string, Matrix> &matrices, const Couriers &couriers) {
+    Matrices shared;
+    for (const auto &courier : couriers) {
+        ptrMatrix &matrix = shared[courier->profile];
+        if (!matrix) {
+            matrix = std::make_shared<const Matrix>(matrices[courier->profile]);
+        }
+    }
+    return shared;
+}
+
+std::map<std::string, bool> symmetric_matrices(const Matrices &matrices) {
+    std::map<std::string, bool> symmetric;
+    for (const auto &[profile, matrix] : matrices) {
+        symmetric[profile] = matrix->static_time() && matrix->symmetric();
+    }
+    return symmetric;
+}
+
+
+//// JobTable
+
+
+JobTable::JobTable(const Storages &storages) {
+    for (const auto &storage : storages) {
+        add(storage);
+        for (const auto &job : storage->unassigned_jobs) {
+            add(job, storage);
+        }
+    }
+}
+
+uint32_t JobTable::add(const ptrJob &job, const ptrStorage &storage) {
+    if (auto it = job_ids.find(job.get()); it != job_ids.end()) {
+        return it->second;
+    }
+    uint32_t storage_id = add(storage);
+    uint32_t id = size();
+    job_ids.emplace(job.get(), id);
+    jobs.push_back(job);
+    this->storage.push_back(storage_id);
+    location.push_back(job->location.matrix_id);
+    delay.push_back(job->delay);
+    priority.push_back(job->priority);
+    demand.emplace_back(job->value);
+    skills.push_back(skill_registry.intern(job->skills));
+    windows.insert(windows.end(), job->time_windows.begin(), job->time_windows.end());
+    window_offsets.push_back(uint32_t(windows.size()));
+    max_windows = std::max(max_windows, uint32_t(job->time_windows.size()));
+    for (uint32_t c = 0; c < couriers.size(); ++c) {
+        bool served = compatible(c, id);
+        bool free = window_free(shifts[c], id);
+        assign(job_rows[c], id, served);
+        assign(free_rows[c], id, free);
+        count_windows(c, served, free);
+    }
+    return id;
+}
+
+uint32_t JobTable::add(const ptrStorage &storage) {
+    if (auto it = storage_ids.find(storage.get()); it != storage_ids.end()) {
+        refresh();  // часы работы могли поменяться
+        return it->second;
+    }
+    auto id = uint32_t(storages.size());
+    storage_ids.emplace(storage.get(), id);
+    storages.push_back(storage);
+    storage_skills.push_back(skill_registry.intern(storage->skills));
+    hours.push_back(storage->work_time);
+    for (uint32_t c = 0; c < couriers.size(); ++c) {
+        bool visited = accessible(c, id);
+        assign(storage_rows[c], id, visited);
+        count_windows(c, visited, window_free(shifts[c], hours[id]));
+    }
+    return id;
+}
+
+uint32_t JobTable::add(const ptrCourier &courier) {
+    if (auto it = courier_ids.find(courier.get()); it != courier_ids.end()) {
+        refresh();  // смена могла поменяться
+        return it->second;
+    }
+    for (const auto &storage : courier->storages) {
+        add(storage);
+    }
+    auto id = uint32_t(couriers.size());
+    courier_ids.emplace(courier.get(), id);
+    couriers.push_back(courier);
+    courier_skills.push_back(skill_registry.intern(courier->skills));
+    shifts.push_back(courier->work_time);
+    storage_rows.emplace_back();
+    job_rows.emplace_back();
+    free_rows.emplace_back();
+    bound_windows.push_back(0);
+    derive(id);
+    return id;
+}
+
+uint32_t JobTable::add_with_jobs(const ptrCourier &courier) {
+    for (const auto &storage : courier->storages) {
+        for (const auto &job : storage->unassigned_jobs) {
+            add(job, storage);
+        }
+    }
+    return add(courier);
+}
+
+/**
+ * Одно и то же окно
+ */
+bool same(const Window &lhs, const Window &rhs) {
+    return lhs.window == rhs.window;
+}
+
+void JobTable::refresh() {
+    bool changed = false;  // часы склада задевают всех курьеров
+    for (uint32_t s = 0; s < storages.size(); ++s) {
+        if (!same(hours[s], storages[s]->work_time)) {
+            hours[s] = storages[s]->work_time;
+            changed = true;
+        }
+    }
+    for (uint32_t c = 0; c < couriers.size(); ++c) {
+        if (changed || !same(shifts[c], couriers[c]->work_time)) {
+            shifts[c] = couriers[c]->work_time;
+            derive(c);
+        }
+    }
+}
+
+bool JobTable::current(uint32_t courier) const {
+    if (!same(shifts[courier], couriers[courier]->work_time)) {
+        return false;
+    }
+    for (uint32_t s = 0; s < storages.size(); ++s) {
+        if (!same(hours[s], storages[s]->work_time)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void JobTable::derive(uint32_t courier) {
+    storage_rows[courier].clear();
+    job_rows[courier].clear();
+    free_rows[courier].clear();
+    bound_windows[courier] = 0;
+    const Window &shift = shifts[courier];
+    for (uint32_t s = 0; s < storages.size(); ++s) {
+        bool visited = accessible(courier, s);
+        assign(storage_rows[courier], s, visited);
+        count_windows(courier, visited, window_free(shift, hours[s]));
+    }
+    for (uint32_t j = 0; j < size(); ++j) {  // совместимость задач - по строке складов выше
+        bool served = compatible(courier, j);
+        bool free = window_free(shift, j);
+        assign(job_rows[courier], j, served);
+        assign(free_rows[courier], j, free);
+        count_windows(courier, served, free);
+    }
+}
+
+void JobTable::assign(std::vector<uint64_t> &row, uint32_t bit, bool value) {
+    if (row.size() <= bit / 64) {
+        row.resize(bit / 64 + 1, 0);
+    }
+    if (value) {
+        row[bit / 64] |= uint64_t(1) << (bit % 64);
+    } else {
+        row[bit / 64] &= ~(uint64_t(1) << (bit % 64));
+    }
+}
+
+bool JobTable::compatible(uint32_t courier, uint32_t job) const {
+    return visits(courier, storage[job]) && courier_skills[courier].covers(skills[job]);
+}
+
+bool JobTable::accessible(uint32_t courier, uint32_t storage) const {
+    return courier_skills[courier].covers(storage_skills[storage]) &&
+           std::ranges::find(couriers[courier]->storages, storages[storage]) != couriers[courier]->storages.end();
+}
+
+bool JobTable::window_free(const Window &shift, uint32_t job) const {
+    const auto &[start_shift, end_shift] = shift.window;
+    return std::ranges::any_of(time_windows(job), [&](const Window &window) {
+        return std::get<0>(window.window) <= start_shift && end_shift <= std::get<1>(window.window);
+    });
+}
+
+bool JobTable::window_free(const Window &shift, const Window &hours) {
+    const auto &[start_shift, end_shift] = shift.window;
+    const auto &[open, close] = hours.window;
+    return open <= start_shift && end_shift <= close;
+}
+
+void JobTable::count_windows(uint32_t courier, bool compatible, bool free) {
+    if (compatible && !free) {  // несовместимые задачи и склады маршрут не посетит
+        ++bound_windows[courier];
+    }
+}
+
+
+//// GranularNeighbors
+
+
+GranularNeighbors::GranularNeighbors(const Matrix &matrix, const JobTable &table, uint32_t k, bool time_windows) {
+    uint32_t size = table.size();
+    k = std::min(k, size == 0 ? 0 : size - 1);
+    std::vector<time_t> earliest(size), latest(size);  // границы окон задачи
+    for (uint32_t i = 0; i < size; ++i) {
+        earliest[i] = std::numeric_limits<time_t>::max();
+        latest[i] = std::numeric_limits<time_t>::min();
+        for (const auto &window : table.time_windows(i)) {
+            earliest[i] = std::min(earliest[i], std::get<0>(window.window));
+            latest[i] = std::max(latest[i], std::get<1>(window.window));
+        }
+    }
+
+    std::vector<std::tuple<time_t, uint32_t>> candidates;
+    candidates.reserve(size);
+    offsets.reserve(size + 1);
+    neighbors.reserve(std::size_t(size) * k);
+    offsets.push_back(0);
+    for (uint32_t i = 0; i < size; ++i) {
+        candidates.clear();
+        int src = table.location[i];
+        bool windows_i = time_windows && !table.time_windows(i).empty();
+        for (uint32_t j = 0; j < size; ++j) {
+            if (i == j) {
+                continue;
+            }
+            time_t score = matrix.get_time(src, table.location[j]);
+            if (windows_i && !table.time_windows(j).empty()) {
+                // окна ограничивают конец обслуживания (см. RvrpProblem::go_job): из i едем и обслуживаем j
+                time_t service = score + table.delay[j];
+                if (earliest[i] + service > latest[j]) {
+                    continue;  // после i к окну j уже не успеть
+                }
+                score += std::max(time_t(0), earliest[j] - (latest[i] + service));  // неизбежное ожидание
+            }
+            candidates.emplace_back(score, j);
+        }
+        std::size_t count = std::min<std::size_t>(k, candidates.size());
+        std::nth_element(candidates.begin(), candidates.begin() + count, candidates.end());
+        std::size_t begin = neighbors.size();
+        for (std::size_t c = 0; c < count; ++c) {
+            neighbors.push_back(std::get<1>(candidates[c]));
+        }
+        std::sort(neighbors.begin() + begin, neighbors.end());
+        offsets.push_back(neighbors.size());
+    }
+}
+
+bool GranularNeighbors::close(uint32_t from, uint32_t to) const {
+    if (from >= size() || to >= size()) {
+        return true;
+    }
+    auto contains = [this](uint32_t job, uint32_t other) {
+        return std::binary_search(neighbors.begin() + offsets[job], neighbors.begin() + offsets[job + 1], other);
+    };
+    return contains(from, to) || contains(to, from);
+}
+
+
 //// Track
 
 
@@ -283,13 +1316,36 @@ std::size_t Route::unassigned_jobs() const {
     return i;
 }
 
+Jobs Route::track_jobs(const Track &track) const {
+    Jobs jobs;
+    jobs.reserve(track.jobs.size());
+    for (uint32_t job : track.jobs) {
+        jobs.push_back(job_table->jobs[job]);
+    }
+    return jobs;
+}
+
 void Route::print() const {
     printf("Route; courier: %s, tracks: %llu, jobs: %llu",
            courier->name.c_str(), tracks.size(), assigned_jobs());
 }
 
-Route::Route(uint16_t vec, time_t start_time, bool circle_track, ptrCourier courier, const Matrix &matrix)
-        : vec(vec), start_time(start_time), courier(std::move(courier)), matrix(matrix), circle_track(circle_track) {}
+Route::Route(uint16_t vec, time_t start_time, bool circle_track, ptrCourier courier, ptrMatrix matrix,
+             ptrJobTable job_table)
+        : vec(vec), start_time(start_time), courier(std::move(courier)), matrix(std::move(matrix)),
+          job_table(std::move(job_table)), circle_track(circle_track) {
+    if (vec > MAX_VALUE_DIMENSION) {
+        throw std::invalid_argument("Route: value dimension " + std::to_string(vec) + " is over MAX_VALUE_DIMENSION");
+    }
+}
+
+std::size_t Route::memory_usage() const {
+    std::size_t bytes = sizeof(Route) + tracks.capacity() * sizeof(Track);
+    for (const auto &track : tracks) {
+        bytes += track.jobs.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
 
 [[maybe_unused]] void Route::draw() const {
     for (const auto &track : tracks) {
@@ -301,3 +1357,84 @@ Route::Route(uint16_t vec, time_t start_time, bool circle_track, ptrCourier cour
     }
     printf("\n");
 }
+
+
+//// EvaluationCache
+
+
+EvaluationCache::EvaluationCache(std::size_t capacity) {
+    capacity = std::bit_ceil(std::max<std::size_t>(capacity, 2));
+    entries.resize(capacity);
+    shift = 64 - std::countr_zero(capacity);
+}
+
+std::tuple<uint64_t, uint64_t> EvaluationCache::fingerprint(const Route &route) {
+    uint64_t hash = 0, check = 0xcbf29ce484222325;
+    auto add = [&hash, &check](uint64_t word) {
+        hash = (std::rotl(hash, 5) ^ word) * 0x517cc1b727220a95;  // FxHash
+        check = (check ^ word) * 0x100000001b3;  // FNV-1a по словам
+    };
+    // все, от чего зависит оценка кроме задач: маршрут и курьера могут поменять на месте (например, из Python)
+    add(uint64_t(route.vec) << 1 | route.circle_track);
+    add(uint64_t(reinterpret_cast<uintptr_t>(route.evaluator)));  // функции не переезжают
+    add(uint64_t(route.start_time));
+    add(route.matrix ? route.matrix->id() : 0);
+    add(route.costs != nullptr);  // стоимости из таблицы округляются иначе
+    const JobTable &table = *route.job_table;
+    const Courier &courier = *route.courier;
+    add(table.index(route.courier));  // совместимость с задачами и складами
+    add(uint64_t(std::get<0>(courier.work_time.window)));
+    add(uint64_t(std::get<1>(courier.work_time.window)));
+    add(uint64_t(uint32_t(courier.start_location.matrix_id)) << 32 | uint32_t(courier.end_location.matrix_id));
+    add(uint64_t(uint32_t(courier.max_distance)));
+    add(uint64_t(std::bit_cast<uint32_t>(courier.cost.start)) << 32 | std::bit_cast<uint32_t>(courier.cost.second));
+    add(std::bit_cast<uint32_t>(courier.cost.meter));
+    for (int value : courier.value) {
+        add(uint32_t(value));
+    }
+    for (const auto &track : route.tracks) {
+        const Storage &storage = *track.storage;
+        add(uint64_t(table.index(track.storage)) << 32 | track.jobs.size());  // граница подмаршрута
+        // точка, перезагрузка и часы склада читаются при оценке напрямую, а не из таблицы
+        add(uint64_t(uint32_t(storage.location.matrix_id)) << 32 | uint32_t(storage.load));
+        add(uint64_t(std::get<0>(storage.work_time.window)));
+        add(uint64_t(std::get<1>(storage.work_time.window)));
+        for (uint32_t job : track.jobs) {
+            add(job);
+        }
+    }
+    return {hash, check ^ check >> 29};
+}
+
+std::optional<State> EvaluationCache::evaluate(const Route &route, RouteEvaluator evaluator) {
+    auto [hash, check] = fingerprint(route);
+    Entry &entry = entries[hash >> shift];
+    if (entry.filled && entry.hash == hash && entry.check == check) {
+        ++hits;
+        return entry.state;
+    }
+    ++misses;
+    if (entry.filled) {
+        ++evictions;
+    } else {
+        ++used;
+    }
+    entry.hash = hash;
+    entry.check = check;
+    entry.filled = true;
+    entry.state = evaluator(route);
+    return entry.state;
+}
+
+void EvaluationCache::clear() {
+    std::fill(entries.begin(), entries.end(), Entry());
+    used = 0;
+}
+
+double EvaluationCache::hit_rate() const {
+    return hits + misses == 0 ? 0 : double(hits) / double(hits + misses);
+}
+
+std::size_t EvaluationCache::memory_usage() const {
+    return entries.size() * sizeof(Entry);
+}
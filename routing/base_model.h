@@ -2,6 +2,7 @@
 #define MADRICH_SOLVER_BASE_MODEL_H
 
 #include <string>
+#include <string_view>
 #include <map>
 #include <vector>
 #include <algorithm>
@@ -10,6 +11,14 @@
 #include <utility>
 #include <sstream>
 #include <memory>
+#include <span>
+#include <functional>
+#include <cstdint>
+#include <array>
+#include <type_traits>
+#include <limits>
+#include <unordered_map>
+#include <bit>
 
 using std::shared_ptr;
 
@@ -28,6 +37,62 @@ using std::shared_ptr;
  */
 
 
+/**
+ * Быстрый генератор псевдослучайных чисел (xoshiro256**), состояние - 32 байта
+ * Заводится один раз и живет у владельца (движок, генератор задач), с одинаковым сидом выдает одну и ту же
+ * последовательность; удовлетворяет UniformRandomBitGenerator, так что подходит для std::shuffle и распределений
+ */
+class Random {
+private:
+    uint64_t state[4]{};
+
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+public:
+    typedef uint64_t result_type;
+
+    /**
+     * Сид из std::random_device
+     */
+    explicit Random();
+
+    explicit Random(uint64_t seed) { this->seed(seed); }
+
+    /**
+     * Перезапуск последовательности, состояние раскладывается из сида через splitmix64
+     */
+    void seed(uint64_t seed);
+
+    static constexpr result_type min() { return 0; }
+
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    result_type operator()() {
+        uint64_t result = rotl(state[1] * 5, 7) * 9;
+        uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
+
+    /**
+     * @return [0, max) умножением старших 32 бит, без деления (смещение порядка max / 2^32)
+     */
+    uint32_t number(uint32_t max) { return uint32_t((((*this)() >> 32) * max) >> 32); }
+
+    /**
+     * @return [0, 1) по старшим 24 битам
+     */
+    float value() { return float((*this)() >> 40) * 0x1.0p-24f; }
+
+    bool boolean() { return ((*this)() >> 63) != 0; }
+};
+
+
 /**
  * Временное окно
  */
@@ -41,11 +106,28 @@ public:
 
     explicit Window(std::tuple<time_t, time_t> window);
 
+    /**
+     * Окно из двух моментов ISO-8601 (см. parse_time)
+     */
     explicit Window(const std::string &start_t, const std::string &end_t);
 
     [[maybe_unused]] void print() const;
 };
 
+/**
+ * Момент ISO-8601 в секундах UTC, без локали, часового пояса процесса и аллокаций
+ * YYYY-MM-DDTHH:MM:SS (или через пробел), доли секунды отбрасываются; смещение Z, +HH:MM, +HHMM, +HH
+ * (или с минусом), без смещения - UTC
+ * @throw std::invalid_argument строка не в этом формате или дата/время вне диапазона
+ */
+time_t parse_time(std::string_view time);
+
+/**
+ * Окна из пар строк (начало, конец) одним проходом, память выделяется один раз
+ * @throw std::invalid_argument как parse_time
+ */
+std::vector<Window> parse_windows(const std::vector<std::tuple<std::string, std::string>> &windows);
+
 
 /**
  * Точка на карте
@@ -84,16 +166,185 @@ public:
 };
 
 
+/**
+ * Выравнивание блоков матрицы (размер кэш-линии)
+ */
+constexpr std::size_t MATRIX_ALIGNMENT = 64;
+
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MADRICH_X86_SIMD  // AVX2 пути через target("avx2"), выбираются во время работы по cpu_has_avx2
+#endif
+
+/**
+ * Умеет ли процессор AVX2 (проверяется один раз); вне x86 всегда false
+ */
+bool cpu_has_avx2();
+
+
+/**
+ * Заголовок бинарного файла матрицы
+ */
+struct MatrixFileHeader {
+    char magic[8];  // "MADRICH"
+    uint32_t version;  // версия формата
+    uint32_t dimension;  // кол-во точек
+    uint32_t slices;  // кол-во срезов по времени
+    uint32_t discreteness;  // дискретность срезов
+    int64_t start_time;  // начало первого среза
+    int64_t end_time;  // конец актуальности матрицы
+    char profile[64];  // профиль, с нулем на конце
+    uint8_t interpolation;  // интерполяция времени между срезами
+    char reserved[23];  // добиваем до MATRIX_ALIGNMENT
+};
+
+
+/**
+ * Способ хранения срезов матрицы
+ */
+enum class MatrixLayout : uint8_t {
+    Flat,  // полная точность: отдельные блоки времени (time_t) и расстояний (int)
+    Quantized,  // по uint16 на время и расстояние, с масштабом и смещением на строку (см. QuantizedRow)
+    Interleaved,  // время и расстояние рядом в одной ячейке MatrixCell, одна кэш-линия на запрос
+    Symmetric,  // как Flat, но только верхний треугольник с диагональю, построчно; для симметричных профилей
+};
+
+
+/**
+ * Ячейка MatrixLayout::Interleaved; время хранится в 32 битах (до ~68 лет в секундах)
+ */
+struct MatrixCell {
+    int32_t travel_time;
+    int32_t distance;
+};
+
+
+/**
+ * Параметры квантования строки матрицы: value = offset + q * scale
+ * offset - минимум по строке, scale = max(1, ceil((max - min) / 65535)), q округляется до ближайшего,
+ * так что ошибка не больше scale / 2. Строки с разбросом времени до 65535 с (~18 ч)
+ * и расстояний до 65.5 км хранятся точно, расстояния до 655 км - с ошибкой не больше 5 м
+ */
+struct QuantizedRow {
+    time_t time_offset;
+    int distance_offset;
+    uint32_t time_scale;
+    uint32_t distance_scale;
+};
+
+
+/**
+ * Корзина индекса срезов: корзина уже среза, поэтому внутри нее не больше одной границы
+ */
+struct SliceBucket {
+    uint32_t slice;  // срез в начале корзины
+    uint64_t boundary;  // смещение от start_time, с которого начинается следующий срез
+};
+
+
+/**
+ * Строка матрицы: время и расстояние от src до каждой из точек во всех срезах
+ * (по size значений на срез в times и distances, срез за срезом; у одного среза - просто строка)
+ */
+typedef std::function<void(uint32_t src, time_t *times, int *distances)> MatrixRow;
+
+
 /**
  * Сущность для хранения матриц
+ * Каждый срез по времени хранится одним плоским row-major блоком, выровненным по кэш-линии:
+ * ячейка (src, dst) лежит по смещению src * size + dst, без лишних разыменований
  */
 class Matrix {
 private:
-    std::vector<std::vector<std::vector<int>>> distance;  // матрица матриц расстояний
-    std::vector<std::vector<std::vector<time_t>>> travel_time;  // матрица матриц времени
+    MatrixLayout layout = MatrixLayout::Flat;  // способ хранения срезов
+    uint32_t size = 0;  // кол-во точек в матрице
+    uint32_t slice_count = 0;  // кол-во срезов по времени
+    std::vector<std::shared_ptr<const int[]>> distance;  // срезы матрицы расстояний (Flat, Symmetric)
+    std::vector<std::shared_ptr<const time_t[]>> travel_time;  // срезы матрицы времени (Flat, Symmetric)
+    std::vector<std::shared_ptr<const uint16_t[]>> quantized_distance;  // срезы расстояний (Quantized)
+    std::vector<std::shared_ptr<const uint16_t[]>> quantized_time;  // срезы времени (Quantized)
+    std::vector<std::shared_ptr<const QuantizedRow[]>> rows;  // параметры строк для каждого среза (Quantized)
+    std::vector<std::shared_ptr<const MatrixCell[]>> cells;  // срезы время + расстояние (Interleaved)
     uint32_t discreteness = 15;  // дискретность матриц (все время разбито по 15 минут по дефолту)
     time_t start_time = 0;  // время начала первой матрицы (начало периода, в котором мы отслеживаем матрицы)
     time_t end_time = 0;  // время конца акутальности матрицы (конец периода, в котором мы отслеживаем матрицы)
+    bool interpolation = false;  // линейная интерполяция времени между соседними срезами
+    uint32_t bucket_shift = 0;  // корзина индекса срезов шириной 2^bucket_shift секунд
+    std::vector<SliceBucket> buckets;  // индекс срезов, вместо деления на discreteness
+    uint64_t identity = next_identity();  // одинаковый только у копий, в отличие от адреса (см. id)
+
+    /**
+     * Новый номер матрицы, свой на каждую построенную матрицу
+     */
+    static uint64_t next_identity();
+
+    /**
+     * Строим индекс срезов
+     */
+    void index_slices();
+
+    /**
+     * Номер среза для текущего момента
+     */
+    [[nodiscard]] uint32_t slice(time_t curr_time) const;
+
+    /**
+     * Момент вне периода матрицы
+     */
+    [[nodiscard]] bool expired(time_t curr_time) const;
+
+    /**
+     * Время с учетом интерполяции к следующему срезу
+     * @param matrix срез для curr_time
+     * @param tt время в этом срезе
+     */
+    [[nodiscard]] time_t interpolate(uint32_t matrix, uint32_t src, uint32_t dst, time_t curr_time, time_t tt) const;
+
+    /**
+     * Смещение ячейки (src, dst) в упакованном треугольнике Symmetric
+     */
+    [[nodiscard]] std::size_t packed(uint32_t src, uint32_t dst) const;
+
+    /**
+     * Время в ячейке среза, без проверок
+     */
+    [[nodiscard]] time_t cell_time(uint32_t matrix, uint32_t src, uint32_t dst) const;
+
+    /**
+     * Расстояние в ячейке среза, без проверок
+     */
+    [[nodiscard]] int cell_distance(uint32_t matrix, uint32_t src, uint32_t dst) const;
+
+    /**
+     * Заполнение срезов в текущем layout
+     * С интерполяцией срезы заполняются с конца и время поправляется до FIFO:
+     * time[k] <= time[k + 1] + discreteness (выехать позже не может быть выгоднее, можно просто подождать),
+     * тогда линейная интерполяция дает неубывающее время прибытия
+     * @param slices кол-во срезов
+     * @param time (срез, src, dst) -> время
+     * @param distance (срез, src, dst) -> расстояние
+     */
+    template<typename Time, typename Distance>
+    void fill(uint32_t slices, Time time, Distance distance);
+
+    /**
+     * Заполнение одного среза
+     * @param k номер среза
+     * @param time (src, dst) -> время
+     * @param distance (src, dst) -> расстояние
+     */
+    template<typename Time, typename Distance>
+    void fill_slice(uint32_t k, Time time, Distance distance);
+
+    /**
+     * Заполнение всех slice_count срезов по строкам: пачки строк считаются параллельно и раскладываются
+     * сразу в layout (Flat с одним срезом пишется прямо в срез, остальное - через буфер строки)
+     * @param row (src, times, distances) -> строка src во всех срезах
+     * @param threads кол-во потоков (0: по числу ядер)
+     */
+    void fill_rows(const MatrixRow &row, uint32_t threads);
+
+    friend class CostMatrix;
 
 public:
     std::string profile;  // профиль матрицы (водитель, пешеход, велосипедист...)
@@ -103,39 +354,314 @@ public:
     Matrix(const Matrix &matrix) = default;
 
     explicit Matrix(std::string profile,
-                    std::vector<std::vector<int>> distance,
-                    std::vector<std::vector<time_t>> travel_time);
+                    const std::vector<std::vector<int>> &distance,
+                    const std::vector<std::vector<time_t>> &travel_time,
+                    MatrixLayout layout = MatrixLayout::Flat);
 
     explicit Matrix(std::string profile,
-                    std::vector<std::vector<std::vector<int>>> distance,
-                    std::vector<std::vector<std::vector<time_t>>> travel_time,
+                    const std::vector<std::vector<std::vector<int>>> &distance,
+                    const std::vector<std::vector<std::vector<time_t>>> &travel_time,
                     uint32_t discreteness,
                     time_t start_time,
-                    time_t end_time);
+                    time_t end_time,
+                    MatrixLayout layout = MatrixLayout::Flat,
+                    bool interpolation = false);
+
+    /**
+     * Перекладывание готовой матрицы в другой layout
+     * @param interpolation интерполировать время между срезами
+     */
+    explicit Matrix(const Matrix &matrix, MatrixLayout layout, bool interpolation = false);
+
+    /**
+     * Один срез, заполняемый построчно: строки считаются параллельно и раскладываются сразу в layout
+     * Flat пишется прямо в срез, остальные layout - через буфер строки; Symmetric берет из строки
+     * только dst >= src, симметричность не проверяется. row вызывается из нескольких потоков и не должен бросать
+     * @param size кол-во точек
+     * @param row (src, times, distances) -> строка src
+     * @param threads кол-во потоков (0: по числу ядер)
+     */
+    explicit Matrix(std::string profile, uint32_t size, const MatrixRow &row,
+                    MatrixLayout layout = MatrixLayout::Flat, uint32_t threads = 0);
+
+    /**
+     * Срезы по времени, заполняемые построчно, как и один срез выше: без промежуточных вложенных векторов
+     * В отличие от конструктора из векторов, время до FIFO не поправляется: для интерполяции
+     * row сам должен давать time[k] <= time[k + 1] + discreteness
+     * @param slices кол-во срезов
+     * @param row (src, times, distances) -> строка src во всех срезах
+     */
+    explicit Matrix(std::string profile, uint32_t size, uint32_t slices, const MatrixRow &row,
+                    uint32_t discreteness, time_t start_time, time_t end_time,
+                    MatrixLayout layout = MatrixLayout::Flat, bool interpolation = false, uint32_t threads = 0);
 
+    /**
+     * Загрузка из бинарного файла (см. save) через mmap, срезы читаются прямо из отображения без копирования
+     * @param path путь до файла
+     */
+    explicit Matrix(const std::string &path);
+
+    /**
+     * Сохранение в бинарный файл: заголовок MatrixFileHeader, затем для каждого среза
+     * блок времени и блок расстояний, каждый выровнен по MATRIX_ALIGNMENT; порядок байт родной
+     * Сохраняется только MatrixLayout::Flat и только матрица хотя бы с одним срезом;
+     * нулевая дискретность допустима лишь для одного среза
+     * @param path путь до файла
+     */
+    void save(const std::string &path) const;
+
+    /**
+     * Время в пути при выезде в момент curr_time
+     * @return время; -1, если момент позже end_time (end_time = 0: матрица бессрочная)
+     */
     [[nodiscard]] time_t get_time(uint32_t src, uint32_t dst, time_t curr_time = 0) const;
 
     [[nodiscard]] int get_distance(uint32_t src, uint32_t dst, time_t curr_time = 0) const;
 
+    /**
+     * Время и расстояние за один запрос (срез и ячейка считаются один раз)
+     * @return (время, расстояние); (-1, -1), если момент за пределами матрицы
+     */
+    [[nodiscard]] std::tuple<time_t, int> get_time_distance(uint32_t src, uint32_t dst, time_t curr_time = 0) const;
+
+    /**
+     * Время и расстояние от одной точки до многих (один срез на весь пакет)
+     * Flat и Interleaved без интерполяции собираются AVX2 gather, если процессор умеет, иначе обычным циклом
+     * @param src откуда
+     * @param dst куда, номера точек
+     * @param times время до dst[i], не короче dst
+     * @param distances расстояние до dst[i], не короче dst
+     * @param curr_time момент выезда; за пределами матрицы все ответы -1
+     */
+    void get_one_to_many(uint32_t src,
+                         std::span<const uint32_t> dst,
+                         std::span<time_t> times,
+                         std::span<int> distances,
+                         time_t curr_time = 0) const;
+
+    /**
+     * Кол-во точек в матрице
+     */
+    [[nodiscard]] uint32_t dimension() const { return size; }
+
+    /**
+     * Номер матрицы: у копий тот же, у любой другой матрицы другой, даже если ее построили на месте удаленной
+     */
+    [[nodiscard]] uint64_t id() const { return identity; }
+
+    /**
+     * Кол-во срезов по времени
+     */
+    [[nodiscard]] uint32_t slices() const { return slice_count; }
+
+    [[nodiscard]] MatrixLayout get_layout() const { return layout; }
+
+    /**
+     * Интерполируется ли время между срезами
+     */
+    [[nodiscard]] bool interpolated() const { return interpolation; }
+
+    /**
+     * Время и расстояние не зависят от момента выезда: один срез и матрица бессрочная
+     */
+    [[nodiscard]] bool static_time() const { return slice_count == 1 && end_time == 0; }
+
+    /**
+     * Симметричны ли все срезы (время и расстояние), т.е. можно ли хранить их в MatrixLayout::Symmetric
+     */
+    [[nodiscard]] bool symmetric() const;
+
+    /**
+     * Сколько байт занимают срезы матрицы
+     */
+    [[nodiscard]] std::size_t memory_usage() const;
+
     [[maybe_unused]] void print() const;
 };
 
+typedef shared_ptr<const Matrix> ptrMatrix;
+typedef std::map<std::string, ptrMatrix> Matrices;
+
+inline uint32_t Matrix::slice(time_t curr_time) const {
+    if (buckets.empty() || curr_time <= start_time) {
+        return 0;
+    }
+    auto offset = uint64_t(curr_time - start_time);
+    std::size_t bucket = offset >> bucket_shift;
+    if (bucket >= buckets.size()) {
+        return slice_count - 1;
+    }
+    return buckets[bucket].slice + (offset >= buckets[bucket].boundary);
+}
+
+inline bool Matrix::expired(time_t curr_time) const {
+    return end_time != 0 && end_time < curr_time;
+}
+
+inline std::size_t Matrix::packed(uint32_t src, uint32_t dst) const {
+    auto [row, column] = std::minmax(src, dst);
+    return std::size_t(row) * (2 * std::size_t(size) - row - 1) / 2 + column;  // строки row длиной size - row
+}
+
+inline time_t Matrix::cell_time(uint32_t matrix, uint32_t src, uint32_t dst) const {
+    std::size_t cell = std::size_t(src) * size + dst;
+    switch (layout) {
+        case MatrixLayout::Flat:
+            return travel_time[matrix][cell];
+        case MatrixLayout::Interleaved:
+            return cells[matrix][cell].travel_time;
+        case MatrixLayout::Symmetric:
+            return travel_time[matrix][packed(src, dst)];
+        case MatrixLayout::Quantized:
+            break;
+    }
+    const QuantizedRow &row = rows[matrix][src];
+    return row.time_offset + time_t(quantized_time[matrix][cell]) * row.time_scale;
+}
+
+inline int Matrix::cell_distance(uint32_t matrix, uint32_t src, uint32_t dst) const {
+    std::size_t cell = std::size_t(src) * size + dst;
+    switch (layout) {
+        case MatrixLayout::Flat:
+            return distance[matrix][cell];
+        case MatrixLayout::Interleaved:
+            return cells[matrix][cell].distance;
+        case MatrixLayout::Symmetric:
+            return distance[matrix][packed(src, dst)];
+        case MatrixLayout::Quantized:
+            break;
+    }
+    const QuantizedRow &row = rows[matrix][src];
+    return row.distance_offset + int(quantized_distance[matrix][cell]) * int(row.distance_scale);
+}
+
+inline time_t Matrix::interpolate(uint32_t matrix, uint32_t src, uint32_t dst, time_t curr_time, time_t tt) const {
+    if (!interpolation || matrix + 1 >= slice_count || curr_time <= start_time) {
+        return tt;
+    }
+    time_t passed = curr_time - start_time - time_t(matrix) * discreteness;
+    return tt + (cell_time(matrix + 1, src, dst) - tt) * passed / time_t(discreteness);
+}
+
+inline time_t Matrix::get_time(uint32_t src, uint32_t dst, time_t curr_time) const {
+    if (expired(curr_time)) { return -1; }
+    uint32_t matrix = slice(curr_time);
+    return interpolate(matrix, src, dst, curr_time, cell_time(matrix, src, dst));
+}
+
+inline int Matrix::get_distance(uint32_t src, uint32_t dst, time_t curr_time) const {
+    if (expired(curr_time)) { return -1; }
+    return cell_distance(slice(curr_time), src, dst);
+}
+
+inline std::tuple<time_t, int> Matrix::get_time_distance(uint32_t src, uint32_t dst, time_t curr_time) const {
+    if (expired(curr_time)) { return {-1, -1}; }
+    uint32_t matrix = slice(curr_time);
+    if (layout == MatrixLayout::Interleaved) {
+        const MatrixCell &cell = cells[matrix][std::size_t(src) * size + dst];
+        return {interpolate(matrix, src, dst, curr_time, cell.travel_time), cell.distance};
+    }
+    return {interpolate(matrix, src, dst, curr_time, cell_time(matrix, src, dst)), cell_distance(matrix, src, dst)};
+}
+
+
+/**
+ * Стоимость переездов для пары (матрица профиля, тариф): second * время + meter * расстояние по ячейкам срезов
+ * Одна таблица на пару, ее разделяют все курьеры с тем же профилем и тарифом: стоимость перегона - одна загрузка
+ * Для матриц с интерполяцией не строится: время там зависит от момента выезда внутри среза
+ */
+class CostMatrix {
+private:
+    ptrMatrix matrix;  // матрица, по которой посчитаны стоимости
+    float second = 0;  // за секунду работы
+    float meter = 0;  // за метр работы
+    std::vector<std::shared_ptr<const float[]>> costs;  // срезы стоимостей, как у матрицы
+
+public:
+    explicit CostMatrix(ptrMatrix matrix, const Cost &cost);
+
+    /**
+     * Стоимость перегона при выезде в момент curr_time; момент не проверяется на end_time,
+     * это уже делает Matrix::get_time_distance
+     */
+    [[nodiscard]] float get_cost(uint32_t src, uint32_t dst, time_t curr_time) const {
+        return costs[matrix->slice(curr_time)][std::size_t(src) * matrix->size + dst];
+    }
+
+    /**
+     * Подходит ли таблица для курьера с такой матрицей и тарифом
+     */
+    [[nodiscard]] bool match(const ptrMatrix &other, const Cost &cost) const {
+        return matrix == other && second == cost.second && meter == cost.meter;
+    }
+
+    /**
+     * Сколько байт занимают срезы стоимостей
+     */
+    [[nodiscard]] std::size_t memory_usage() const;
+};
+
+typedef shared_ptr<const CostMatrix> ptrCostMatrix;
+
+/**
+ * Наибольшая размерность вектора веса/объема (задачи, курьера, загруженности)
+ */
+constexpr uint32_t MAX_VALUE_DIMENSION = 8;
+
+
+/**
+ * Вектор загруженности с емкостью MAX_VALUE_DIMENSION прямо внутри, без кучи
+ */
+class Load {
+private:
+    std::array<int, MAX_VALUE_DIMENSION> values{};
+    uint32_t count = 0;
+
+public:
+    Load() = default;
+
+    /**
+     * Нулевой вектор размерности size
+     */
+    explicit Load(uint32_t size);
+
+    explicit Load(const std::vector<int> &values);
+
+    [[nodiscard]] uint32_t size() const { return count; }
+
+    int &operator[](uint32_t i) { return values[i]; }
+
+    int operator[](uint32_t i) const { return values[i]; }
+
+    [[nodiscard]] const int *begin() const { return values.data(); }
+
+    [[nodiscard]] const int *end() const { return values.data() + count; }
+
+    /**
+     * Поэлементная сумма, размерность остается левой
+     */
+    Load &operator+=(const Load &rhs);
+
+    bool operator==(const Load &rhs) const;
+
+    [[nodiscard]] std::vector<int> to_vector() const { return {begin(), end()}; }
+};
+
 
 /**
  * Некоторая оценка, цена, стоимость маршрута, тура или куска чего-то
+ * Тривиально копируется: загруженность лежит внутри, сложение и сравнение не трогают кучу
  */
 class State {
 public:
     time_t travel_time = 0;  // время
     int distance = 0;  // расстояние
     float cost = 0;  // стоимость
-    std::optional<std::vector<int>> value;  // вектор загруженности
+    std::optional<Load> value;  // вектор загруженности
 
     explicit State() = default;
 
-    State(const State &state) = default;
-
-    explicit State(time_t travel_time, int distance, float cost, std::optional<std::vector<int>> value = std::nullopt);
+    explicit State(time_t travel_time, int distance, float cost, std::optional<Load> value = std::nullopt);
 
     [[maybe_unused]] void print() const;
 
@@ -150,7 +676,57 @@ public:
     bool operator<(const State &rhs) const;
 
 private:
-    static std::optional<std::vector<int>> sum_values(const State &lt, const State &rt);
+    static std::optional<Load> sum_values(const State &lt, const State &rt);
+};
+
+static_assert(std::is_trivially_copyable_v<State>);
+
+
+/**
+ * Набор умений битами: первые 64 умения в одном слове, остальные - в overflow
+ * Номера битов выдает SkillRegistry; проверка умений - AND по словам вместо сравнения строк
+ */
+class SkillSet {
+public:
+    uint64_t bits = 0;  // умения 0..63
+    std::vector<uint64_t> overflow;  // умения от 64, по 64 на слово (обычно пусто)
+
+    SkillSet() = default;
+
+    void set(uint32_t position);
+
+    /**
+     * Есть все умения из required
+     */
+    [[nodiscard]] bool covers(const SkillSet &required) const {
+        if (required.bits & ~bits) {
+            return false;
+        }
+        return required.overflow.empty() || covers_overflow(required);
+    }
+
+private:
+    [[nodiscard]] bool covers_overflow(const SkillSet &required) const;
+};
+
+
+/**
+ * Словарь умений: строка -> номер бита, номера выдаются по мере появления
+ */
+class SkillRegistry {
+private:
+    std::unordered_map<std::string, uint32_t> positions;
+
+public:
+    /**
+     * Умения битами; новые строки получают следующие номера
+     */
+    SkillSet intern(const std::vector<std::string> &skills);
+
+    /**
+     * Кол-во различных умений
+     */
+    [[nodiscard]] std::size_t size() const { return positions.size(); }
 };
 
 
@@ -283,24 +859,347 @@ typedef shared_ptr<Courier> ptrCourier;
 typedef std::vector<shared_ptr<Courier>> Couriers;
 
 
+/**
+ * Номера задач подмаршрута в таблице задач (см. JobTable)
+ */
+typedef std::vector<uint32_t> JobIds;
+
+/**
+ * Номер "нет задачи": склад или край подмаршрута
+ */
+constexpr uint32_t NO_JOB = std::numeric_limits<uint32_t>::max();
+
+
+/**
+ * Таблица задач тура: задача - плотный номер (JobTable::index), поля для оценки маршрута лежат столбцами
+ * Подмаршруты хранят номера, так что копия трека - копия массива чисел, без счетчиков ссылок;
+ * ptrJob остается фасадом (jobs) для складов, вставки и Python
+ * Умения задач, складов и курьеров тура переводятся в биты одним словарем (skill_registry)
+ * Склады и курьеры тоже получают номера, по ним битовая матрица совместимости: какие задачи курьер может
+ * взять (склад ему доступен и умений хватает) и на какие склады заезжать; строки пересчитываются при добавлении
+ * Там же биты задач без действующих для курьера окон (окно накрывает всю смену) и счетчик его задач и складов,
+ * окна которых ограничивают: у курьера без таких маршрут оценивается без ожиданий (см. RvrpProblem::window_free)
+ *
+ * Номера и умения битами живут только в таблице (объект -> номер), сами задачи, склады и курьеры их не хранят:
+ * одни и те же объекты можно класть в несколько таблиц (два движка на одних складах, копии складов)
+ * Поля задачи (точка, обслуживание, приоритет, груз, умения, окна) копируются при добавлении, дальше таблица
+ * их не перечитывает: задачу, уже добавленную в таблицу, менять нельзя - нужна новая таблица (новый движок)
+ * Смена курьера и часы работы складов тоже запоминаются при добавлении: пока биты окон посчитаны по другим
+ * часам, курьер считается ограниченным окнами (current), а refresh или повторный add пересчитывают биты
+ */
+class JobTable {
+public:
+    Jobs jobs;  // номер -> задача
+    Storages storages;  // номер -> склад
+    Couriers couriers;  // номер -> курьер
+    std::vector<uint32_t> storage;  // номер склада задачи
+    std::vector<int> location;  // matrix_id точки задачи
+    std::vector<int> delay;  // время на обслуживание
+    std::vector<int> priority;  // приоритет
+    std::vector<Load> demand;  // вектор веса/объема
+    std::vector<SkillSet> skills;  // требуемые умения битами
+    std::vector<uint32_t> window_offsets = {0};  // начало окон задачи в windows (CSR)
+    std::vector<Window> windows;  // окна всех задач подряд
+    uint32_t max_windows = 0;  // наибольшее кол-во окон у одной задачи
+    std::vector<SkillSet> storage_skills;  // номер склада -> требуемые умения битами
+    std::vector<SkillSet> courier_skills;  // номер курьера -> умения битами
+    SkillRegistry skill_registry;  // умения тура -> номера битов
+
+    explicit JobTable() = default;
+
+    /**
+     * Склады и все их неназначенные задачи, по порядку складов
+     */
+    explicit JobTable(const Storages &storages);
+
+    /**
+     * Добавляет задачу склада и выдает ей номер; уже добавленная задача номер сохраняет
+     * @return номер задачи
+     */
+    uint32_t add(const ptrJob &job, const ptrStorage &storage);
+
+    /**
+     * Добавляет склад: номер и умения битами; у уже добавленного склада с новыми часами работы
+     * пересчитываются биты окон
+     * @return номер склада
+     */
+    uint32_t add(const ptrStorage &storage);
+
+    /**
+     * Добавляет курьера и его склады: номер, умения битами и строку совместимости;
+     * у уже добавленного курьера с новой сменой пересчитываются биты окон
+     * @return номер курьера
+     */
+    uint32_t add(const ptrCourier &courier);
+
+    /**
+     * Добавляет курьера и неназначенные задачи его складов (маршрут, собранный вне движка, берет задачи оттуда)
+     * @return номер курьера
+     */
+    uint32_t add_with_jobs(const ptrCourier &courier);
+
+    /**
+     * Пересчитывает биты окон курьеров, у которых с добавления поменялась смена или часы работы складов
+     */
+    void refresh();
+
+    /**
+     * Номер задачи (склада, курьера) в таблице
+     * @throw std::out_of_range объекта нет в таблице
+     */
+    [[nodiscard]] uint32_t index(const ptrJob &job) const { return job_ids.at(job.get()); }
+
+    [[nodiscard]] uint32_t index(const ptrStorage &storage) const { return storage_ids.at(storage.get()); }
+
+    [[nodiscard]] uint32_t index(const ptrCourier &courier) const { return courier_ids.at(courier.get()); }
+
+    /**
+     * Задача уже в таблице
+     */
+    [[nodiscard]] bool contains(const ptrJob &job) const { return job_ids.contains(job.get()); }
+
+    [[nodiscard]] bool contains(const ptrStorage &storage) const { return storage_ids.contains(storage.get()); }
+
+    [[nodiscard]] bool contains(const ptrCourier &courier) const { return courier_ids.contains(courier.get()); }
+
+    /**
+     * Курьер может взять задачу: склад задачи ему доступен и умений хватает
+     * @param courier номер курьера
+     * @param job номер задачи
+     */
+    [[nodiscard]] bool serves(uint32_t courier, uint32_t job) const {
+        return test(job_rows[courier], job);
+    }
+
+    /**
+     * Курьер может заезжать на склад: склад в его списке и умений хватает
+     * @param courier номер курьера
+     * @param storage номер склада
+     */
+    [[nodiscard]] bool visits(uint32_t courier, uint32_t storage) const {
+        return test(storage_rows[courier], storage);
+    }
+
+    /**
+     * Окна задачи не ограничивают курьера: одно из них накрывает всю его смену, ждать не придется никогда
+     * Бит посчитан по смене на момент добавления: верен, только пока current(courier)
+     * @param courier номер курьера
+     * @param job номер задачи
+     */
+    [[nodiscard]] bool window_free(uint32_t courier, uint32_t job) const {
+        return test(free_rows[courier], job);
+    }
+
+    /**
+     * Ни одна задача, которую курьер может взять, и ни один его склад не ограничивают его окнами
+     * (и биты окон не устарели, см. current)
+     * @param courier номер курьера
+     */
+    [[nodiscard]] bool window_free(uint32_t courier) const {
+        return bound_windows[courier] == 0 && current(courier);
+    }
+
+    /**
+     * Биты окон курьера посчитаны по его нынешней смене и нынешним часам работы складов
+     * @param courier номер курьера
+     */
+    [[nodiscard]] bool current(uint32_t courier) const;
+
+    /**
+     * Временные окна задачи
+     */
+    [[nodiscard]] std::span<const Window> time_windows(uint32_t job) const {
+        return {windows.data() + window_offsets[job], windows.data() + window_offsets[job + 1]};
+    }
+
+    [[nodiscard]] uint32_t size() const { return uint32_t(jobs.size()); }
+
+private:
+    std::unordered_map<const Job *, uint32_t> job_ids;  // задача -> номер
+    std::unordered_map<const Storage *, uint32_t> storage_ids;  // склад -> номер
+    std::unordered_map<const Courier *, uint32_t> courier_ids;  // курьер -> номер
+    std::vector<Window> shifts;  // курьер -> смена, по которой посчитаны его биты окон
+    std::vector<Window> hours;  // склад -> часы работы, по которым посчитаны биты окон
+    std::vector<std::vector<uint64_t>> job_rows;  // курьер -> биты задач, которые он может взять
+    std::vector<std::vector<uint64_t>> storage_rows;  // курьер -> биты доступных складов
+    std::vector<std::vector<uint64_t>> free_rows;  // курьер -> биты задач, окна которых его не ограничивают
+    std::vector<uint32_t> bound_windows;  // курьер -> кол-во его задач и складов с ограничивающими окнами
+
+    static bool test(const std::vector<uint64_t> &row, uint32_t bit) {
+        return bit / 64 < row.size() && (row[bit / 64] >> (bit % 64) & 1);
+    }
+
+    static void assign(std::vector<uint64_t> &row, uint32_t bit, bool value);
+
+    /**
+     * Курьер может взять задачу, может заезжать на склад (по умениям битами и списку складов курьера)
+     */
+    [[nodiscard]] bool compatible(uint32_t courier, uint32_t job) const;
+
+    [[nodiscard]] bool accessible(uint32_t courier, uint32_t storage) const;
+
+    /**
+     * Окна задачи (часы склада) накрывают смену
+     */
+    [[nodiscard]] bool window_free(const Window &shift, uint32_t job) const;
+
+    [[nodiscard]] static bool window_free(const Window &shift, const Window &hours);
+
+    /**
+     * Строки курьера заново: совместимость, биты окон и bound_windows по его нынешней смене
+     */
+    void derive(uint32_t courier);
+
+    /**
+     * Учесть задачу или склад курьера в bound_windows
+     */
+    void count_windows(uint32_t courier, bool compatible, bool free);
+};
+
+typedef shared_ptr<const JobTable> ptrJobTable;
+
+
+/**
+ * Неизменяемые матрицы по профилям курьеров: одна копия на профиль, ее разделяют все маршруты
+ * @param matrices матрицы для профилей курьеров
+ * @param couriers курьеры
+ * @return профиль -> общая матрица
+ */
+Matrices share_matrices(std::map<std::string, Matrix> &matrices, const Couriers &couriers);
+
+/**
+ * Какие из общих матриц симметричны: Matrix::symmetric, один проход на матрицу
+ * Проверяются только матрицы без срезов (Matrix::static_time), остальные считаются несимметричными
+ * @return профиль -> симметрична ли
+ */
+std::map<std::string, bool> symmetric_matrices(const Matrices &matrices);
+
+
+/**
+ * Гранулярные соседи: для каждой задачи k ближайших к ней задач по времени в пути
+ * С учетом окон ближе те, к кому можно успеть с меньшим ожиданием; несовместимые по окнам соседями не бывают
+ * Ходы операторов с ограничением должны создавать хотя бы одну дугу между соседями
+ */
+class GranularNeighbors {
+private:
+    std::vector<uint32_t> offsets;  // начало списка соседей задачи (CSR)
+    std::vector<uint32_t> neighbors;  // номера соседей, по возрастанию внутри списка
+
+public:
+    /**
+     * @param matrix матрица, по ней время в пути (первый срез)
+     * @param table все задачи тура, соседи по их номерам
+     * @param k сколько соседей у задачи
+     * @param time_windows учитывать временные окна
+     */
+    explicit GranularNeighbors(const Matrix &matrix, const JobTable &table, uint32_t k, bool time_windows = false);
+
+    /**
+     * Дуга from -> to между соседями (в любую сторону)
+     * Склад (NO_JOB) и задачи не из индекса соседствуют со всеми
+     */
+    [[nodiscard]] bool close(uint32_t from, uint32_t to) const;
+
+    /**
+     * Кол-во задач в индексе
+     */
+    [[nodiscard]] std::size_t size() const { return offsets.size() - 1; }
+};
+
+typedef shared_ptr<const GranularNeighbors> ptrNeighbors;
+
+
 /**
  * Подмаршрут
  */
 class Track {
 public:
     ptrStorage storage;  // задачи берутся из этого склада
-    Jobs jobs;  // назначенные задачи
+    JobIds jobs;  // назначенные задачи, номера в таблице задач маршрута
 
     Track() = default;
 
     explicit Track(ptrStorage storage) : storage(std::move(storage)) {}
 
-    explicit Track(const ptrJob &job, ptrStorage storage) : storage(std::move(storage)), jobs({job}) {}
+    explicit Track(uint32_t job, ptrStorage storage) : storage(std::move(storage)), jobs({job}) {}
 
     [[maybe_unused]] void print() const;
 };
 
 
+class Route;
+
+/**
+ * Оценка и валидация всего маршрута, специализированная под его vec и circle_track (см. RvrpProblem::evaluator)
+ */
+typedef std::optional<State> (*RouteEvaluator)(const Route &route);
+
+
+/**
+ * Память оценок маршрутов: отпечаток маршрута (vec, circle_track, вариант оценки, начало, матрица, ограничения
+ * и тариф курьера, подмаршруты - склад с точкой, перезагрузкой и часами работы, задачи) -> оценка
+ * Операторы и фазы улучшения снова и снова оценивают одни и те же маршруты (inter_replace туда и обратно,
+ * повторные intra/inter на каждой фазе, возврат к лучшим маршрутам): повторная оценка - хеш по номерам задач
+ * вместо прохода по матрице. Таблица фиксированного размера с прямым отображением: новый маршрут вытесняет
+ * старый из своей ячейки. Отпечаток - два независимых 64-битных хеша, случайное совпадение не встречается
+ * Не потокобезопасна; после изменения задач, складов или окон под теми же номерами ее надо очистить
+ */
+class EvaluationCache {
+public:
+    uint64_t hits = 0;  // оценка нашлась
+    uint64_t misses = 0;  // пришлось оценивать
+    uint64_t evictions = 0;  // оценка вытеснила другую из ячейки
+
+    /**
+     * @param capacity сколько маршрутов помнить (округляется вверх до степени двойки, не меньше 2)
+     */
+    explicit EvaluationCache(std::size_t capacity);
+
+    /**
+     * Оценка маршрута из памяти, а если ее там нет - через evaluator с запоминанием
+     */
+    std::optional<State> evaluate(const Route &route, RouteEvaluator evaluator);
+
+    /**
+     * Забыть все оценки, счетчики не трогаются
+     */
+    void clear();
+
+    /**
+     * Сколько маршрутов помнит сейчас и может помнить
+     */
+    [[nodiscard]] std::size_t size() const { return used; }
+
+    [[nodiscard]] std::size_t capacity() const { return entries.size(); }
+
+    /**
+     * Доля попаданий среди всех запросов
+     */
+    [[nodiscard]] double hit_rate() const;
+
+    [[nodiscard]] std::size_t memory_usage() const;
+
+private:
+    struct Entry {
+        uint64_t hash = 0;  // номер ячейки и первая половина отпечатка
+        uint64_t check = 0;  // вторая половина
+        bool filled = false;
+        std::optional<State> state;
+    };
+
+    std::vector<Entry> entries;
+    uint32_t shift = 63;  // ячейка - старшие биты hash
+    std::size_t used = 0;
+
+    /**
+     * Отпечаток маршрута: (hash, check)
+     */
+    static std::tuple<uint64_t, uint64_t> fingerprint(const Route &route);
+};
+
+typedef shared_ptr<EvaluationCache> ptrEvaluationCache;
+
+
 /**
  * Маршрут
  */
@@ -308,15 +1207,22 @@ class Route {
 public:
     uint16_t vec = 0;  // размерность вектора вместимости
     ptrCourier courier;  // курьер
-    Matrix matrix;  // Матрица курьера
+    ptrMatrix matrix;  // Матрица курьера, общая для всех маршрутов с тем же профилем
+    ptrCostMatrix costs;  // Стоимости перегонов, общие для курьеров с тем же профилем и тарифом (может не быть)
+    ptrNeighbors neighbors;  // Гранулярные соседи, ограничивают ходы операторов (может не быть)
+    ptrJobTable job_table;  // Таблица задач тура, по ней номера в треках
     time_t start_time = 0;  // время начала с начала мира
     State state;  // стоимость маршрута
     bool circle_track = true;  // надо возвращаться на склад
+    bool symmetric = false;  // матрица симметрична и без срезов (см. symmetric_matrices)
+    RouteEvaluator evaluator = nullptr;  // выбранный вариант оценки (может не быть: выбирается при оценке)
+    ptrEvaluationCache cache;  // память оценок, общая на тур (может не быть, см. MadrichEngine::cache_states)
     std::vector<Track> tracks;  // все подмаршруты
 
     explicit Route() = default;
 
-    Route(uint16_t vec, time_t start_time, bool circle_track, ptrCourier courier, const Matrix &matrix);
+    Route(uint16_t vec, time_t start_time, bool circle_track, ptrCourier courier, ptrMatrix matrix,
+          ptrJobTable job_table = nullptr);
 
     /**
      * Кол-во задач, назначенных на этого курьера
@@ -328,6 +1234,16 @@ public:
      */
     [[nodiscard]] std::size_t unassigned_jobs() const;
 
+    /**
+     * Задачи подмаршрута по номерам из таблицы (фасад для Python и отладки)
+     */
+    [[nodiscard]] Jobs track_jobs(const Track &track) const;
+
+    /**
+     * Сколько байт занимает сам маршрут (без матрицы, она общая)
+     */
+    [[nodiscard]] std::size_t memory_usage() const;
+
     [[maybe_unused]] void print() const;
 
     [[maybe_unused]] void draw() const;
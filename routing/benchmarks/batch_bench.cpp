@@ -0,0 +1,89 @@
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <generators.h>
+
+using namespace std::chrono;
+
+constexpr int REPEATS = 3;
+constexpr std::size_t LOOKUPS = 1 << 22;  // всего запросов на один размер пакета
+
+
+/**
+ * Пакеты dst из случайных src: по одному запросу или одним get_one_to_many
+ * @return лучшее кол-во запросов в секунду из REPEATS попыток
+ */
+double run(const Matrix &matrix, const std::vector<uint32_t> &sources, const std::vector<uint32_t> &dst,
+           bool batched, int64_t &checksum) {
+    std::size_t batch = dst.size();
+    std::vector<time_t> times(batch);
+    std::vector<int> distances(batch);
+    double best = 0;
+    for (int r = 0; r < REPEATS; ++r) {
+        int64_t sum = 0;
+        auto start = steady_clock::now();
+        for (uint32_t src : sources) {
+            if (batched) {
+                matrix.get_one_to_many(src, dst, times, distances);
+            } else {
+                for (std::size_t i = 0; i < batch; ++i) {
+                    std::tie(times[i], distances[i]) = matrix.get_time_distance(src, dst[i]);
+                }
+            }
+            sum += times[batch - 1] + distances[batch / 2];
+        }
+        checksum += sum;
+        best = std::max(best, double(sources.size() * batch) / duration<double>(steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+/**
+ * Пакетный ответ совпадает с поштучным
+ */
+bool check(const Matrix &matrix, uint32_t src, const std::vector<uint32_t> &dst) {
+    std::vector<time_t> times(dst.size());
+    std::vector<int> distances(dst.size());
+    matrix.get_one_to_many(src, dst, times, distances);
+    for (std::size_t i = 0; i < dst.size(); ++i) {
+        if (std::tuple(times[i], distances[i]) != matrix.get_time_distance(src, dst[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    uint32_t size = argc > 1 ? std::stoul(argv[1]) : 2000;
+    printf("Generating %u points...\n", size);
+    std::vector pts = generate_points(size);
+    Matrix flat("driver", generate_distance(pts), generate_time(pts));
+    Matrix interleaved(flat, MatrixLayout::Interleaved);
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint32_t> uni(0, size - 1);
+    int64_t checksum = 0;
+    printf("batch\tflat scalar\tflat batch\tinterleaved scalar\tinterleaved batch (M lookups/s)\n");
+    for (std::size_t batch = 16; batch <= 4096; batch *= 4) {
+        std::vector<uint32_t> dst(batch + 3);  // хвост не кратен 8
+        for (auto &id : dst) {
+            id = uni(rng);
+        }
+        std::vector<uint32_t> sources(LOOKUPS / dst.size());
+        for (auto &id : sources) {
+            id = uni(rng);
+        }
+        if (!check(flat, sources[0], dst) || !check(interleaved, sources[0], dst)) {
+            printf("batch %zu: mismatch\n", dst.size());
+            return 1;
+        }
+        double flat_scalar = run(flat, sources, dst, false, checksum);
+        double flat_batch = run(flat, sources, dst, true, checksum);
+        double inter_scalar = run(interleaved, sources, dst, false, checksum);
+        double inter_batch = run(interleaved, sources, dst, true, checksum);
+        printf("%zu\t%.1f\t\t%.1f (x%.2f)\t%.1f\t\t\t%.1f (x%.2f)\n", dst.size(),
+               flat_scalar / 1e6, flat_batch / 1e6, flat_batch / flat_scalar,
+               inter_scalar / 1e6, inter_batch / 1e6, inter_batch / inter_scalar);
+    }
+    printf("checksum: %ld\n", checksum);
+}
@@ -0,0 +1,29 @@
+#include "bench_utils.h"
+
+
+std::tuple<Storages, Couriers> copy_instance(const Storages &storages, const Couriers &couriers) {
+    Storages storages_copy;
+    for (const auto &storage : storages) {
+        storages_copy.push_back(std::make_shared<Storage>(*storage));
+    }
+    Couriers couriers_copy;
+    for (const auto &courier : couriers) {
+        auto copy = std::make_shared<Courier>(*courier);
+        for (auto &storage : copy->storages) {
+            auto it = std::find(storages.begin(), storages.end(), storage);
+            storage = storages_copy[std::distance(storages.begin(), it)];
+        }
+        couriers_copy.push_back(copy);
+    }
+    return {storages_copy, couriers_copy};
+}
+
+void split_windows(const Storages &storages) {
+    for (const auto &storage : storages) {
+        for (const auto &job : storage->unassigned_jobs) {
+            auto [start, end] = job->time_windows[0].window;
+            time_t middle = start + (end - start) / 2;
+            job->time_windows = {Window({start, middle - 600}), Window({middle + 600, end})};
+        }
+    }
+}
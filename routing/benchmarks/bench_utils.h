@@ -0,0 +1,19 @@
+#ifndef MADRICH_SOLVER_BENCH_UTILS_H
+#define MADRICH_SOLVER_BENCH_UTILS_H
+
+#include <base_model.h>
+
+
+/**
+ * Копия складов и курьеров: build_tour разбирает unassigned_jobs складов, а сравнивать надо на одинаковых данных
+ * @return склады и курьеры, курьеры ссылаются на скопированные склады
+ */
+std::tuple<Storages, Couriers> copy_instance(const Storages &storages, const Couriers &couriers);
+
+/**
+ * Окно каждой задачи делится на два с перерывом посередине: у задач несколько окон, склейка (RouteSegments)
+ * неприменима, и ходы оцениваются get_state
+ */
+void split_windows(const Storages &storages);
+
+#endif //MADRICH_SOLVER_BENCH_UTILS_H
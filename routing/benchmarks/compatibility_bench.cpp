@@ -0,0 +1,97 @@
+#include <chrono>
+#include <cstdio>
+#include <generators.h>
+#include <local_search/problem.h>
+
+using namespace std::chrono;
+
+
+/**
+ * Совместимость курьера и задачи по отдельным проверкам, как в insert_job до матрицы
+ */
+bool checks(const Route &route, uint32_t job) {
+    const JobTable &table = *route.job_table;
+    const ptrStorage &storage = table.storages[table.storage[job]];
+    return RvrpProblem::validate_storage(storage, route.courier) &&
+           RvrpProblem::validate_skills(job, route) &&
+           RvrpProblem::validate_skills(storage, route);
+}
+
+/**
+ * Пар курьер x задача в секунду
+ */
+template<typename Check>
+double pairs_rate(const std::vector<Route> &routes, const JobTable &table, int repeats, Check check,
+                  int64_t &checksum) {
+    auto start = steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        for (const auto &route : routes) {
+            for (uint32_t job = 0; job < table.size(); ++job) {
+                checksum += check(route, job);
+            }
+        }
+    }
+    double pairs = double(repeats) * double(routes.size()) * double(table.size());
+    return pairs / duration<double>(steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+    int jobs = argc > 1 ? std::stoi(argv[1]) : 300;
+    int repeats = argc > 2 ? std::stoi(argv[2]) : 300;
+
+    InstanceConfig config;
+    config.jobs = jobs;
+    config.storages = 4;
+    config.couriers = 30;
+    config.heterogeneous = true;
+    config.seed = 5;
+    auto[vec, couriers, storages, matrices] = generate_instance(config);
+    Random random(5);
+    for (auto &courier : couriers) {  // каждому курьеру - примерно половина складов
+        Storages available;
+        for (const auto &storage : courier->storages) {
+            if (random.boolean()) {
+                available.push_back(storage);
+            }
+        }
+        courier->storages = available.empty() ? Storages{courier->storages[0]} : available;
+    }
+
+    MadrichEngine engine(vec, storages, couriers, matrices, true, true);
+    const JobTable &table = *engine.job_table;
+    std::vector<uint32_t> rows;  // номера курьеров маршрутов в таблице
+    std::size_t served = 0;
+    for (const auto &route : engine.routes) {
+        rows.push_back(table.index(route.courier));
+        for (uint32_t job = 0; job < table.size(); ++job) {
+            bool bit = table.serves(rows.back(), job);
+            if (bit != checks(route, job)) {
+                printf("matrix mismatch\n");
+                return 1;
+            }
+            served += bit;
+        }
+    }
+    printf("jobs: %u, couriers: %zu, compatible pairs: %.1f%%\n", table.size(), engine.routes.size(),
+           100. * double(served) / double(table.size() * engine.routes.size()));
+
+    int64_t checksum = 0;
+    double checks_rate = 0, matrix_rate = 0;
+    for (int round = 0; round < 3; ++round) {  // по очереди, чтобы шум делился поровну
+        checks_rate = std::max(checks_rate, pairs_rate(engine.routes, table, repeats, checks, checksum));
+        matrix_rate = std::max(matrix_rate, pairs_rate(engine.routes, table, repeats,
+                                                       [&](const Route &route, uint32_t job) {
+                                                           return table.serves(rows[&route - engine.routes.data()],
+                                                                               job);
+                                                       }, checksum));
+    }
+    printf("checks/s\tmatrix/s\tspeedup\n%.3g\t\t%.3g\t\tx%.1f\n", checks_rate, matrix_rate,
+           matrix_rate / checks_rate);
+
+    auto start = steady_clock::now();
+    engine.build_tour();
+    double elapsed = duration<double>(steady_clock::now() - start).count();
+    State state = engine.get_state();
+    printf("build_tour: %.2f s, jobs: %zu/%d, cost: %.1f\n", elapsed, engine.assigned_jobs(), jobs, state.cost);
+    printf("checksum: %jd\n", checksum);
+}
@@ -0,0 +1,86 @@
+#include <chrono>
+#include <cstdio>
+#include <generators.h>
+#include <local_search/problem.h>
+
+using namespace std::chrono;
+
+
+/**
+ * Копий/с всего тура, как в continuous_improve (лучшая копия и откат)
+ */
+double tour_copies(const std::vector<Route> &routes, int repeats, std::size_t &checksum) {
+    auto start = steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        std::vector copy(routes);
+        checksum += copy.back().tracks.size();
+    }
+    return double(repeats) / duration<double>(steady_clock::now() - start).count();
+}
+
+/**
+ * Копий/с массива задач подмаршрута, как в операторах (tmp_jobs, insert, swap)
+ */
+double track_copies(const std::vector<Route> &routes, int repeats, std::size_t &checksum) {
+    std::size_t copies = 0;
+    auto start = steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        for (const auto &route : routes) {
+            for (const auto &track : route.tracks) {
+                auto jobs = track.jobs;
+                checksum += jobs.size();
+                ++copies;
+            }
+        }
+    }
+    return double(copies) / duration<double>(steady_clock::now() - start).count();
+}
+
+/**
+ * Оценок/с всех маршрутов тура
+ */
+double evaluations(const std::vector<Route> &routes, int repeats, std::size_t &checksum) {
+    auto start = steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        for (const auto &route : routes) {
+            auto state = RvrpProblem::get_state(route);
+            checksum += state ? state->distance : 0;
+        }
+    }
+    return double(repeats) * double(routes.size()) / duration<double>(steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+    int jobs = argc > 1 ? std::stoi(argv[1]) : 10000;
+    int repeats = argc > 2 ? std::stoi(argv[2]) : 200;
+
+    InstanceConfig config;
+    config.jobs = jobs;
+    config.locations = std::min(jobs, 2000);
+    config.storages = 4;
+    config.couriers = 100;
+    config.points = PointsFamily::Mixed;
+    config.seed = 17;
+    auto[vec, couriers, storages, matrices] = generate_instance(config);
+    for (auto &courier : couriers) {
+        std::fill(courier->value.begin(), courier->value.end(), jobs);  // в тур должны попасть все задачи
+    }
+    MadrichEngine engine = RvrpProblem::init_tour(vec, storages, couriers, matrices, true);
+
+    std::size_t checksum = 0;
+    std::size_t tracks = 0;
+    for (const auto &route : engine.routes) {
+        tracks += route.tracks.size();
+    }
+    printf("jobs: %zu/%zu, routes: %zu, tracks: %zu\n",
+           engine.assigned_jobs(), engine.assigned_jobs() + engine.unassigned_jobs(), engine.routes.size(), tracks);
+    printf("tour copies/s\ttrack copies/s\tget_state/s\n");
+    double tour_rate = 0, track_rate = 0, state_rate = 0;
+    for (int round = 0; round < 3; ++round) {
+        tour_rate = std::max(tour_rate, tour_copies(engine.routes, repeats, checksum));
+        track_rate = std::max(track_rate, track_copies(engine.routes, repeats, checksum));
+        state_rate = std::max(state_rate, evaluations(engine.routes, repeats / 10 + 1, checksum));
+    }
+    printf("%.0f\t\t%.0f\t\t%.0f\n", tour_rate, track_rate, state_rate);
+    printf("checksum: %zu\n", checksum);
+}
@@ -0,0 +1,37 @@
+#include <chrono>
+#include <generators.h>
+#include <benchmarks/bench_utils.h>
+#include <local_search/engine.h>
+
+using namespace std::chrono;
+
+
+/**
+ * Построение тура вставками (insert_best), с таблицами стоимостей или без
+ */
+double build(int vec, const Storages &storages, const Couriers &couriers,
+             std::map<std::string, Matrix> &matrices, bool cache) {
+    auto[storages_copy, couriers_copy] = copy_instance(storages, couriers);
+    MadrichEngine engine(vec, storages_copy, couriers_copy, matrices, true, true);
+    if (cache) {
+        engine.cache_costs();
+        engine.memory_report();
+    }
+    auto start = steady_clock::now();
+    engine.build_tour();
+    double elapsed = duration<double>(steady_clock::now() - start).count();
+    State state = engine.get_state();
+    printf("%s: %.2f s, assigned: %zu, cost: %.1f\n", cache ? "cached" : "arithmetic",
+           elapsed, engine.assigned_jobs(), state.cost);
+    return elapsed;
+}
+
+int main(int argc, char **argv) {
+    int jobs = argc > 1 ? std::stoi(argv[1]) : 1000;
+    int couriers = argc > 2 ? std::stoi(argv[2]) : 10;
+    auto[vec, courier_list, storages, matrices] = generate_rvrp(jobs / 2, 2, couriers);
+
+    double arithmetic = build(vec, storages, courier_list, matrices, false);
+    double cached = build(vec, storages, courier_list, matrices, true);
+    printf("Jobs: %d, couriers: %d, speedup: %.2fx\n", jobs, couriers, arithmetic / cached);
+}
@@ -0,0 +1,57 @@
+#include <chrono>
+#include <cstdio>
+#include <generators.h>
+#include <local_search/problem.h>
+
+using namespace std::chrono;
+
+
+/**
+ * get_state/s для всех маршрутов тура с заданным вариантом оценки
+ */
+double throughput(std::vector<Route> &routes, RouteEvaluator evaluator, int repeats, int64_t &checksum) {
+    for (auto &route : routes) {
+        route.evaluator = evaluator;
+    }
+    auto start = steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        for (const auto &route : routes) {
+            auto state = RvrpProblem::get_state(route);
+            checksum += state ? state->travel_time : -1;
+        }
+    }
+    double elapsed = duration<double>(steady_clock::now() - start).count();
+    return double(repeats) * double(routes.size()) / elapsed;
+}
+
+int main(int argc, char **argv) {
+    int repeats = argc > 1 ? std::stoi(argv[1]) : 3000;
+    int64_t checksum = 0;
+    printf("vec\tcircle\tgeneric/s\tspecialized/s\tspeedup\n");
+    for (bool circle_track : {true, false}) {
+        auto[vec, couriers, storages, matrices] = generate_rvrp(100, 3, 5, 1);
+        MadrichEngine engine = RvrpProblem::init_tour(vec, storages, couriers, matrices, circle_track);
+        RouteEvaluator generic = circle_track ? &RvrpProblem::evaluate<0, true> : &RvrpProblem::evaluate<0, false>;
+        RouteEvaluator specialized = RvrpProblem::evaluator(vec, circle_track);
+
+        // одинаковый результат у обоих вариантов
+        for (auto &route : engine.routes) {
+            auto lhs = generic(route), rhs = specialized(route);
+            if (lhs.has_value() != rhs.has_value() || (lhs && (lhs->travel_time != rhs->travel_time ||
+                                                                lhs->distance != rhs->distance ||
+                                                                lhs->cost != rhs->cost))) {
+                printf("variants mismatch\n");
+                return 1;
+            }
+        }
+
+        double generic_rate = 0, specialized_rate = 0;
+        for (int round = 0; round < 3; ++round) {  // по очереди, чтобы шум делился поровну
+            generic_rate = std::max(generic_rate, throughput(engine.routes, generic, repeats, checksum));
+            specialized_rate = std::max(specialized_rate, throughput(engine.routes, specialized, repeats, checksum));
+        }
+        printf("%d\t%d\t%.0f\t\t%.0f\t\tx%.2f\n", vec, circle_track, generic_rate, specialized_rate,
+               specialized_rate / generic_rate);
+    }
+    printf("checksum: %jd\n", checksum);
+}
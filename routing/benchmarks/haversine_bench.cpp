@@ -0,0 +1,90 @@
+#include <chrono>
+#include <cstdio>
+#include <generators.h>
+
+using namespace std::chrono;
+
+constexpr std::size_t MEMORY_LIMIT = std::size_t(2) << 30;  // больше матрицу не строим, только считаем строки
+
+
+/**
+ * Секунд на построение
+ */
+template<typename F>
+double measure(F build) {
+    auto start = steady_clock::now();
+    build();
+    return duration<double>(steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+    uint32_t max_size = argc > 1 ? std::stoul(argv[1]) : 50000;
+    uint32_t threads = argc > 2 ? std::stoul(argv[2]) : 0;
+    printf("threads: %u (0: all), avx2: %d\n", threads, cpu_has_avx2());
+
+    // сверка с generate_distance/generate_time
+    std::vector check_points = generate_points(1000);
+    Matrix reference("driver", generate_distance(check_points), generate_time(check_points));
+    Matrix matrix = generate_matrix("driver", check_points);
+    int distance_error = 0;
+    time_t time_error = 0;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        for (uint32_t j = 0; j < 1000; ++j) {
+            distance_error = std::max(distance_error, std::abs(matrix.get_distance(i, j) - reference.get_distance(i, j)));
+            time_error = std::max(time_error, std::abs(matrix.get_time(i, j) - reference.get_time(i, j)));
+        }
+    }
+    printf("max difference: %d m, %jd s\n\n", distance_error, time_error);
+
+    printf("points\told (s)\tnew (s)\tlayout\t\tM cells/s\n");
+    for (uint32_t size : {1000u, 2000u, 5000u, 10000u, 20000u, 50000u}) {
+        if (size > max_size) {
+            break;
+        }
+        std::vector points = generate_points(int(size));
+        double cells = double(size) * size;
+
+        double old_time = 0;
+        if (size <= 5000) {  // дольше ждать и вложенные вектора уже не влезают
+            old_time = measure([&points]() {
+                Matrix old("driver", generate_distance(points), generate_time(points));
+            });
+        }
+
+        MatrixLayout layout = MatrixLayout::Flat;
+        const char *name = "Flat";
+        if (cells * (sizeof(time_t) + sizeof(int)) > MEMORY_LIMIT) {
+            layout = MatrixLayout::Symmetric;
+            name = "Symmetric";
+        }
+        if (cells * (sizeof(time_t) + sizeof(int)) / 2 > MEMORY_LIMIT) {
+            layout = MatrixLayout::Quantized;
+            name = "Quantized";
+        }
+        double new_time;
+        if (cells * 2 * sizeof(uint16_t) <= MEMORY_LIMIT) {
+            new_time = measure([&points, layout, threads]() {
+                Matrix matrix = generate_matrix("driver", points, layout, threads);
+            });
+        } else {  // только сами строки, в один поток
+            name = "rows only";
+            MatrixRow row = haversine_rows(points);
+            std::vector<time_t> times(size);
+            std::vector<int> distances(size);
+            int64_t checksum = 0;
+            new_time = measure([&]() {
+                for (uint32_t i = 0; i < size; ++i) {
+                    row(i, times.data(), distances.data());
+                    checksum += distances[size - 1];
+                }
+            });
+            printf("(checksum %jd)\n", checksum);
+        }
+        if (old_time > 0) {
+            printf("%u\t%.2f\t%.2f\t%s\t\t%.0f (x%.1f)\n", size, old_time, new_time, name, cells / new_time / 1e6,
+                   old_time / new_time);
+        } else {
+            printf("%u\t-\t%.2f\t%s\t%.0f\n", size, new_time, name, cells / new_time / 1e6);
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#include <chrono>
+#include <cstdio>
+#include <generators.h>
+
+using namespace std::chrono;
+
+
+/**
+ * С одинаковым сидом задачи совпадают: точки, окна, веса и курьеры
+ */
+bool same_instance(const InstanceConfig &config) {
+    auto[vec_a, couriers_a, storages_a, matrices_a] = generate_instance(config);
+    auto[vec_b, couriers_b, storages_b, matrices_b] = generate_instance(config);
+    for (std::size_t s = 0; s < storages_a.size(); ++s) {
+        const Jobs &a = storages_a[s]->unassigned_jobs, &b = storages_b[s]->unassigned_jobs;
+        for (std::size_t i = 0; i < a.size(); ++i) {
+            if (a[i]->location.point != b[i]->location.point || a[i]->value != b[i]->value ||
+                a[i]->skills != b[i]->skills || a[i]->time_windows[0].window != b[i]->time_windows[0].window) {
+                return false;
+            }
+        }
+    }
+    for (std::size_t i = 0; i < couriers_a.size(); ++i) {
+        if (!(*couriers_a[i] == *couriers_b[i]) || couriers_a[i]->value != couriers_b[i]->value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    int jobs = argc > 1 ? std::stoi(argv[1]) : 100000;
+    int locations = argc > 2 ? std::stoi(argv[2]) : 5000;
+
+    InstanceConfig check;
+    check.jobs = 2000;
+    check.storages = 3;
+    check.points = PointsFamily::Mixed;
+    check.heterogeneous = true;
+    check.seed = 7;
+    if (!same_instance(check)) {
+        printf("seed: mismatch\n");
+        return 1;
+    }
+
+    const std::pair<PointsFamily, const char *> families[] = {
+            {PointsFamily::Random,    "R"},
+            {PointsFamily::Clustered, "C"},
+            {PointsFamily::Mixed,     "RC"},
+    };
+    printf("jobs: %d, locations: %d\n", jobs, locations);
+    printf("family\ttotal (s)\tjobs (s)\tjobs/s\n");
+    for (auto[family, name] : families) {
+        for (bool tight : {true, false}) {
+            InstanceConfig config;
+            config.jobs = jobs;
+            config.locations = locations;
+            config.storages = 4;
+            config.couriers = 200;
+            config.points = family;
+            config.tight_windows = tight;
+            config.heterogeneous = true;
+            config.profiles = {{"driver", 10}, {"cyclist", 4}};
+            config.layout = MatrixLayout::Quantized;
+            config.seed = 1;
+
+            auto start = steady_clock::now();
+            auto result = generate_instance(config);
+            double total = duration<double>(steady_clock::now() - start).count();
+
+            // то же с одной точкой задач: почти без матрицы, только задачи и курьеры
+            config.locations = 1;
+            config.profiles = {{"driver", 10}};
+            start = steady_clock::now();
+            auto light = generate_instance(config);
+            double entities = duration<double>(steady_clock::now() - start).count();
+            printf("%s%d\t%.2f\t\t%.3f\t\t%.0f\n", name, tight ? 1 : 2, total, entities, jobs / entities);
+        }
+    }
+}
@@ -0,0 +1,123 @@
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <generators.h>
+
+using namespace std::chrono;
+
+
+/**
+ * Старое представление матрицы: вектор векторов векторов, для сравнения
+ */
+struct NestedMatrix {
+    std::vector<std::vector<std::vector<int>>> distance;
+    std::vector<std::vector<std::vector<time_t>>> travel_time;
+
+    [[nodiscard]] time_t get_time(uint32_t src, uint32_t dst) const { return travel_time[0][src][dst]; }
+
+    [[nodiscard]] int get_distance(uint32_t src, uint32_t dst) const { return distance[0][src][dst]; }
+};
+
+constexpr int REPEATS = 3;
+
+/**
+ * Прогон всех запросов, возвращает лучшее кол-во запросов в секунду из REPEATS попыток
+ */
+template<typename M>
+double run(const M &matrix, const std::vector<std::tuple<uint32_t, uint32_t>> &queries, int64_t &checksum) {
+    double best = 0;
+    for (int r = 0; r < REPEATS; ++r) {
+        int64_t sum = 0;
+        auto start = steady_clock::now();
+        for (const auto &[src, dst] : queries) {
+            sum += matrix.get_time(src, dst) + matrix.get_distance(src, dst);
+        }
+        checksum += sum;
+        best = std::max(best, double(queries.size()) / duration<double>(steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+/**
+ * То же, но через совмещенный запрос времени и расстояния
+ */
+double run_combined(const Matrix &matrix, const std::vector<std::tuple<uint32_t, uint32_t>> &queries, int64_t &checksum) {
+    double best = 0;
+    for (int r = 0; r < REPEATS; ++r) {
+        int64_t sum = 0;
+        auto start = steady_clock::now();
+        for (const auto &[src, dst] : queries) {
+            auto [tt, d] = matrix.get_time_distance(src, dst);
+            sum += tt + d;
+        }
+        checksum += sum;
+        best = std::max(best, double(queries.size()) / duration<double>(steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+int main(int argc, char **argv) {
+    uint32_t size = argc > 1 ? std::stoul(argv[1]) : 5000;
+    uint32_t number = argc > 2 ? std::stoul(argv[2]) : 1 << 22;
+    printf("Generating %u points...\n", size);
+    std::vector pts = generate_points(size);
+    NestedMatrix nested{{generate_distance(pts)}, {generate_time(pts)}};
+    Matrix matrix("driver", nested.distance[0], nested.travel_time[0]);
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint32_t> uni(0, size - 1);
+    std::vector<std::tuple<uint32_t, uint32_t>> queries(number);
+    for (auto &query : queries) {
+        query = {uni(rng), uni(rng)};
+    }
+
+    int64_t checksum = 0;
+    double nested_rate = run(nested, queries, checksum);
+    double flat_rate = run(matrix, queries, checksum);
+    printf("nested: %.1f M lookups/s\n", nested_rate / 1e6);
+    printf("flat:   %.1f M lookups/s (x%.2f), %zu MB\n",
+           flat_rate / 1e6, flat_rate / nested_rate, matrix.memory_usage() >> 20);
+
+    Matrix quantized(matrix, MatrixLayout::Quantized);
+    double quantized_rate = run(quantized, queries, checksum);
+    time_t time_error = 0;
+    int distance_error = 0;
+    for (uint32_t i = 0; i < size; ++i) {
+        for (uint32_t j = 0; j < size; ++j) {
+            time_error = std::max(time_error, std::abs(quantized.get_time(i, j) - matrix.get_time(i, j)));
+            distance_error = std::max(distance_error, std::abs(quantized.get_distance(i, j) - matrix.get_distance(i, j)));
+        }
+    }
+    printf("quantized: %.1f M lookups/s (x%.2f), %zu MB, max error: %jd s, %d m\n",
+           quantized_rate / 1e6, quantized_rate / nested_rate, quantized.memory_usage() >> 20,
+           time_error, distance_error);
+
+    Matrix interleaved(matrix, MatrixLayout::Interleaved);
+    double flat_combined_rate = run_combined(matrix, queries, checksum);
+    double interleaved_rate = run_combined(interleaved, queries, checksum);
+    printf("flat combined: %.1f M lookups/s (x%.2f)\n", flat_combined_rate / 1e6, flat_combined_rate / nested_rate);
+    printf("interleaved combined: %.1f M lookups/s (x%.2f), %zu MB\n",
+           interleaved_rate / 1e6, interleaved_rate / nested_rate, interleaved.memory_usage() >> 20);
+
+    Matrix symmetric(matrix, MatrixLayout::Symmetric);  // generate_* дают симметричные матрицы
+    double symmetric_rate = run(symmetric, queries, checksum);
+    double symmetric_combined_rate = run_combined(symmetric, queries, checksum);
+    printf("symmetric: %.1f M lookups/s (x%.2f), combined: %.1f M lookups/s, %zu MB\n",
+           symmetric_rate / 1e6, symmetric_rate / nested_rate, symmetric_combined_rate / 1e6,
+           symmetric.memory_usage() >> 20);
+
+    // загрузка: сборка из вложенных векторов против отображения файла
+    std::string path = "matrix_bench.bin";
+    matrix.save(path);
+    auto start = steady_clock::now();
+    Matrix built("driver", nested.distance[0], nested.travel_time[0]);
+    double build_time = duration<double, std::milli>(steady_clock::now() - start).count();
+    start = steady_clock::now();
+    Matrix mapped(path);
+    double map_time = duration<double, std::milli>(steady_clock::now() - start).count();
+    double mapped_rate = run(mapped, queries, checksum);
+    printf("build: %.2f ms, mmap: %.2f ms, mapped lookups: %.1f M/s\n", build_time, map_time, mapped_rate / 1e6);
+    std::remove(path.c_str());
+
+    printf("checksum: %jd\n", checksum);
+}
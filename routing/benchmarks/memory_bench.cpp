@@ -0,0 +1,21 @@
+#include <chrono>
+#include <generators.h>
+#include <local_search/engine.h>
+
+using namespace std::chrono;
+
+
+int main(int argc, char **argv) {
+    int jobs = argc > 1 ? std::stoi(argv[1]) : 500;
+    for (int couriers : {1, 10, 50, 200}) {
+        auto[vec, courier_list, storages, matrices] = generate_rvrp(jobs, 2, couriers);
+        MadrichEngine engine(vec, storages, courier_list, matrices, true, true);
+        printf("Couriers: %d\n", couriers);
+        engine.memory_report();
+
+        auto start = steady_clock::now();
+        std::vector routes_copy(engine.routes);  // так копирует continuous_improve
+        double elapsed = duration<double, std::micro>(steady_clock::now() - start).count();
+        printf("Routes copy: %.1f us\n\n", elapsed);
+    }
+}
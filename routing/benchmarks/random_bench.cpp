@@ -0,0 +1,75 @@
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <generators.h>
+#include <local_search/engine.h>
+
+using namespace std::chrono;
+
+constexpr int REPEATS = 3;
+
+
+/**
+ * Старый generate_number: random_device и mt19937_64 на каждую выборку
+ */
+int legacy_number(int max) {
+    std::random_device rd;
+    std::mt19937_64 rng(rd());
+    std::uniform_int_distribution<int> uni(0, max - 1);
+    return uni(rng);
+}
+
+/**
+ * @return лучшее время одной выборки в нс из REPEATS попыток
+ */
+template<typename F>
+double run(std::size_t draws, int64_t &checksum, F draw) {
+    double best = 0;
+    for (int r = 0; r < REPEATS; ++r) {
+        int64_t sum = 0;
+        auto start = steady_clock::now();
+        for (std::size_t i = 0; i < draws; ++i) {
+            sum += draw(int(i % 1000) + 1);
+        }
+        checksum += sum;
+        double ns = duration<double, std::nano>(steady_clock::now() - start).count() / double(draws);
+        best = r == 0 ? ns : std::min(best, ns);
+    }
+    return best;
+}
+
+/**
+ * С одинаковым сидом генерация и improve дают одно и то же
+ */
+bool check_seed() {
+    State states[2];
+    for (auto &state : states) {
+        auto[vec, couriers, storages, matrices] = generate_rvrp(30, 2, 3, 7);
+        MadrichEngine engine(vec, storages, couriers, matrices, true, true);
+        engine.seed(7);
+        engine.build_tour();
+        engine.improve(0, 3, 3);
+        state = engine.get_state();
+    }
+    return states[0].travel_time == states[1].travel_time && states[0].distance == states[1].distance &&
+           states[0].cost == states[1].cost;
+}
+
+int main(int argc, char **argv) {
+    std::size_t draws = argc > 1 ? std::stoul(argv[1]) : 1 << 24;
+    if (!check_seed()) {
+        printf("seed: mismatch\n");
+        return 1;
+    }
+
+    int64_t checksum = 0;
+    Random random(42);
+    double legacy = run(draws / 256, checksum, legacy_number);
+    double global = run(draws, checksum, [](int max) { return generate_number(max); });
+    double owned = run(draws, checksum, [&random](int max) { return int(random.number(max)); });
+    printf("source\t\t\tns/draw\n");
+    printf("random_device+mt19937\t%.2f\n", legacy);
+    printf("generate_number\t\t%.2f (x%.0f)\n", global, legacy / global);
+    printf("Random::number\t\t%.2f (x%.0f)\n", owned, legacy / owned);
+    printf("checksum: %ld\n", checksum);
+}
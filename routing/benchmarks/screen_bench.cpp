@@ -0,0 +1,217 @@
+#include <chrono>
+#include <cstdio>
+#include <generators.h>
+#include <benchmarks/bench_utils.h>
+#include <local_search/operators/route_utils.h>
+#include <local_search/problem.h>
+#include <local_search/segment.h>
+
+using namespace std::chrono;
+
+
+/**
+ * Проверки границ: отсеянный ход get_state не оценил бы лучше best, граница не выше точной оценки
+ */
+struct Violations {
+    std::size_t moves = 0;
+    std::size_t screened = 0;  // отсеяно
+    std::size_t wrong = 0;
+};
+
+/**
+ * Граница не выше точной оценки маршрута: время без ожиданий не больше travel_time, расстояние то же
+ */
+bool below(const RouteBound &bound, const std::optional<State> &full) {
+    return !full || (bound.duration <= full->travel_time && bound.distance == full->distance);
+}
+
+void check(Violations &violations, bool passed, bool below, const std::optional<State> &full, const State &best,
+           const char *move) {
+    ++violations.moves;
+    violations.screened += !passed;
+    if ((!passed && full && full.value() < best) || !below) {
+        if (violations.wrong++ < 5) {
+            printf("wrong screen in %s: passed %d, below %d\n", move, passed, below);
+        }
+    }
+}
+
+/**
+ * Случайные ходы в маршруте: 2-opt и 3-opt; best - текущая оценка или "любая выполнимая" (отсев только по
+ * ограничениям курьера)
+ */
+void intra(Route &route, Random &random, Violations &violations) {
+    ScreenCounters counters;
+    RouteSegments segments(route);
+    State current = RvrpProblem::get_state(route).value();
+    State any(std::numeric_limits<time_t>::max() / 4, 0, 0);
+    for (std::size_t t = 0; t < route.tracks.size(); ++t) {
+        Track &track = route.tracks[t];
+        JobIds jobs = track.jobs;
+        auto size = uint32_t(jobs.size());
+        segments.select(t, jobs);
+        for (int r = 0; r < 20 && size >= 4; ++r) {
+            const State &best = r % 2 ? current : any;
+            uint32_t it1 = random.number(size - 1), it3 = it1 + 1 + random.number(size - it1 - 1);
+            Segment reversed;
+            for (uint32_t k = it1; k <= it3; ++k) {
+                reversed = segments.concat(segments.job(jobs[k]), reversed);
+            }
+            RouteBound bound = segments.bound(it1, it3 + 1, reversed);
+            track.jobs = swap(jobs, it1, it3);
+            std::optional full = RvrpProblem::get_state(route);
+            check(violations, RouteSegments::screen(counters, route, bound, best), below(bound, full), full, best,
+                  "2-opt");
+
+            uint32_t x = random.number(size - 2);
+            uint32_t y = x + 1 + random.number(size - x - 2);
+            uint32_t z = y + 1 + random.number(size - y - 1);
+            uint32_t exchange = random.number(4);
+            JobIds exchanged = three_opt_exchange(jobs, exchange, x, y, z);
+            Segment middle;
+            for (uint32_t k = x + 1; k <= z; ++k) {
+                middle = segments.concat(middle, segments.job(exchanged[k]));
+            }
+            bound = segments.bound(x + 1, z + 1, middle);
+            track.jobs = exchanged;
+            full = RvrpProblem::get_state(route);
+            check(violations, RouteSegments::screen(counters, route, bound, best), below(bound, full), full, best,
+                  "3-opt");
+            track.jobs = jobs;
+        }
+    }
+}
+
+/**
+ * Случайные обмены кусков (cross, для длины 1 - swap) между подмаршрутами двух маршрутов с одним складом
+ */
+void inter(Route &route1, Route &route2, Random &random, Violations &violations) {
+    ScreenCounters counters;
+    RouteSegments segments1(route1), segments2(route2);
+    State current = RvrpProblem::get_state(route1).value() + RvrpProblem::get_state(route2).value();
+    State any(std::numeric_limits<time_t>::max() / 4, 0, 0);
+    for (std::size_t t1 = 0; t1 < route1.tracks.size(); ++t1) {
+        for (std::size_t t2 = 0; t2 < route2.tracks.size(); ++t2) {
+            Track &track1 = route1.tracks[t1];
+            Track &track2 = route2.tracks[t2];
+            JobIds jobs1 = track1.jobs, jobs2 = track2.jobs;
+            auto size1 = uint32_t(jobs1.size()), size2 = uint32_t(jobs2.size());
+            if (track1.storage != track2.storage || size1 == 0 || size2 == 0) {
+                continue;
+            }
+            segments1.select(t1, jobs1);
+            segments2.select(t2, jobs2);
+            for (int r = 0; r < 20; ++r) {
+                const State &best = r % 2 ? current : any;
+                uint32_t it1 = random.number(size1), it2 = it1 + random.number(std::min(3u, size1 - it1));
+                uint32_t it3 = random.number(size2), it4 = it3 + random.number(std::min(3u, size2 - it3));
+                Segment piece1, piece2;  // куски для route2 и route1
+                for (uint32_t k = it1; k <= it2; ++k) {
+                    piece1 = segments2.concat(piece1, segments2.job(jobs1[k]));
+                }
+                for (uint32_t k = it3; k <= it4; ++k) {
+                    piece2 = segments1.concat(piece2, segments1.job(jobs2[k]));
+                }
+                RouteBound bound1 = segments1.bound(it1, it2 + 1, piece2);
+                RouteBound bound2 = segments2.bound(it3, it4 + 1, piece1);
+                std::tie(track1.jobs, track2.jobs) = cross(jobs1, jobs2, it1, it2, it3, it4);
+                std::optional full1 = RvrpProblem::get_state(route1);
+                std::optional full2 = RvrpProblem::get_state(route2);
+                std::optional<State> full;
+                if (full1 && full2) {
+                    full = full1.value() + full2.value();
+                }
+                bool passed = RouteSegments::screen(counters, route1, bound1, route2, bound2, best);
+                check(violations, passed, below(bound1, full1) && below(bound2, full2), full, best,
+                      it1 == it2 && it3 == it4 ? "swap" : "cross");
+                track1.jobs = jobs1;
+                track2.jobs = jobs2;
+            }
+        }
+    }
+}
+
+/**
+ * Ходов 2-opt в секунду по всем парам (it1, it3), как в two_opt без склейки: get_state на каждый ход
+ * или сначала отсев по границе с best - текущей оценкой маршрута
+ */
+double two_opt_rate(std::vector<Route> &routes, bool screened, ScreenCounters &counters, int64_t &checksum) {
+    std::size_t moves = 0;
+    auto start = steady_clock::now();
+    for (auto &route : routes) {
+        RouteSegments segments(route);
+        for (std::size_t t = 0; t < route.tracks.size(); ++t) {
+            Track &track = route.tracks[t];
+            JobIds jobs = track.jobs;
+            auto size = uint32_t(jobs.size());
+            segments.select(t, jobs);
+            for (uint32_t it1 = 0; it1 < size; ++it1) {
+                Segment reversed = segments.job(jobs[it1]);
+                for (uint32_t it3 = it1 + 1; it3 < size; ++it3) {
+                    reversed = segments.concat(segments.job(jobs[it3]), reversed);
+                    ++moves;
+                    if (screened &&
+                        !RouteSegments::screen(counters, route, segments.bound(it1, it3 + 1, reversed), route.state)) {
+                        continue;
+                    }
+                    track.jobs = swap(jobs, it1, it3);
+                    std::optional state = RvrpProblem::get_state(route);
+                    track.jobs = jobs;
+                    checksum += state ? state->travel_time : -1;
+                }
+            }
+        }
+    }
+    return double(moves) / duration<double>(steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+    int jobs = argc > 1 ? std::stoi(argv[1]) : 1000;
+
+    InstanceConfig config;
+    config.jobs = jobs;
+    config.storages = 2;
+    config.couriers = 10;
+    config.heterogeneous = true;
+    config.seed = 37;
+    auto[vec, couriers, storages, matrices] = generate_instance(config);
+    split_windows(storages);
+    MadrichEngine engine = RvrpProblem::init_tour(vec, storages, couriers, matrices, true);
+
+    std::size_t bounded = 0, usable = 0;
+    for (auto &route : engine.routes) {
+        route.state = RvrpProblem::get_state(route).value();
+        bounded += RouteSegments::bounded(route);
+        usable += RouteSegments::usable(route);
+    }
+    printf("jobs: %zu/%d, routes: %zu, bounded: %zu, usable: %zu\n", engine.assigned_jobs(), jobs,
+           engine.routes.size(), bounded, usable);
+
+    Random random(37);
+    Violations violations;
+    for (std::size_t i = 0; i < engine.routes.size(); ++i) {
+        intra(engine.routes[i], random, violations);
+        if (i + 1 < engine.routes.size()) {
+            inter(engine.routes[i], engine.routes[i + 1], random, violations);
+        }
+    }
+    printf("moves: %zu, screened: %zu, wrong: %zu\n", violations.moves, violations.screened, violations.wrong);
+    if (violations.wrong != 0 || bounded != engine.routes.size() || usable != 0) {
+        printf("screen mismatch\n");
+        return 1;
+    }
+
+    int64_t full_checksum = 0, screened_checksum = 0;
+    double full_rate = 0, screened_rate = 0;
+    ScreenCounters counters;
+    for (int round = 0; round < 3; ++round) {  // по очереди, чтобы шум делился поровну
+        counters = ScreenCounters();
+        full_rate = std::max(full_rate, two_opt_rate(engine.routes, false, counters, full_checksum));
+        screened_rate = std::max(screened_rate, two_opt_rate(engine.routes, true, counters, screened_checksum));
+    }
+    printf("2-opt moves: %ju, by arcs: %ju, by limits: %ju, evaluated: %ju\n", uintmax_t(counters.moves),
+           uintmax_t(counters.arcs), uintmax_t(counters.limits), uintmax_t(counters.evaluated));
+    printf("2-opt moves/s: get_state %.3g, screened %.3g, x%.1f\n", full_rate, screened_rate,
+           screened_rate / full_rate);
+    printf("checksum: %jd\n", full_checksum + screened_checksum);
+}
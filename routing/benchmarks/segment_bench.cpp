@@ -0,0 +1,256 @@
+#include <chrono>
+#include <cstdio>
+#include <generators.h>
+#include <local_search/operators/route_utils.h>
+#include <local_search/problem.h>
+#include <local_search/segment.h>
+
+using namespace std::chrono;
+
+
+/**
+ * Расхождения склейки и get_state по видам ходов
+ */
+struct Differences {
+    std::size_t moves = 0;
+    std::size_t feasible = 0;
+    std::size_t mismatches = 0;
+};
+
+/**
+ * Склейка дает то же, что get_state: выполнимость, время и расстояние точно, стоимость - до округления float
+ */
+bool same(const std::optional<State> &segments, const std::optional<State> &full) {
+    if (!segments || !full) {
+        return !segments && !full;
+    }
+    float tolerance = 1e-5f * std::max(1.f, std::abs(full->cost));
+    return segments->travel_time == full->travel_time && segments->distance == full->distance &&
+           std::abs(segments->cost - full->cost) <= tolerance;
+}
+
+void count(Differences &differences, const std::optional<State> &segments, const std::optional<State> &full,
+           const char *move) {
+    ++differences.moves;
+    differences.feasible += full.has_value();
+    if (!same(segments, full)) {
+        if (differences.mismatches++ < 5) {
+            printf("mismatch in %s: segments %jd/%d/%.3f, full %jd/%d/%.3f\n", move,
+                   segments ? segments->travel_time : -1, segments ? segments->distance : -1,
+                   segments ? segments->cost : -1.f, full ? full->travel_time : -1, full ? full->distance : -1,
+                   full ? full->cost : -1.f);
+        }
+    }
+}
+
+/**
+ * Куски задач jobs[from, to) подряд и задом наперед
+ */
+std::tuple<Segment, Segment> pieces(const RouteSegments &segments, const JobIds &jobs, uint32_t from, uint32_t to) {
+    Segment forward, backward;
+    for (uint32_t k = from; k < to; ++k) {
+        forward = segments.concat(forward, segments.job(jobs[k]));
+        backward = segments.concat(segments.job(jobs[k]), backward);
+    }
+    return {forward, backward};
+}
+
+/**
+ * Случайные ходы в маршруте: склейка против get_state на маршруте с записанным ходом
+ */
+void differential(Route &route, Random &random, Differences &differences) {
+    const JobTable &table = *route.job_table;
+    RouteSegments segments(route);
+    for (std::size_t t = 0; t < route.tracks.size(); ++t) {
+        Track &track = route.tracks[t];
+        JobIds jobs = track.jobs;
+        auto size = uint32_t(jobs.size());
+        segments.select(t, jobs);
+
+        for (int r = 0; r < 20; ++r) {
+            // вставка любой задачи тура (в том числе чужой и несовместимой) на любое место
+            uint32_t job = random.number(table.size());
+            uint32_t k = random.number(size + 1);
+            track.jobs = insert(k, job, jobs);
+            count(differences, segments.replaced(k, k, segments.job(job)), RvrpProblem::get_state(route), "insert");
+
+            // удаление (подмаршрут может опустеть)
+            k = random.number(size);
+            track.jobs = jobs;
+            track.jobs.erase(track.jobs.begin() + k);
+            count(differences, segments.replaced(k, k + 1, Segment()), RvrpProblem::get_state(route), "remove");
+
+            // кусок [from, to) заменяется на 1-3 случайные задачи, как в cross
+            uint32_t from = random.number(size), to = from + 1 + random.number(size - from);
+            JobIds piece_jobs(1 + random.number(3));
+            for (auto &piece_job : piece_jobs) {
+                piece_job = random.number(table.size());
+            }
+            track.jobs = JobIds(jobs.begin(), jobs.begin() + from);
+            track.jobs.insert(track.jobs.end(), piece_jobs.begin(), piece_jobs.end());
+            track.jobs.insert(track.jobs.end(), jobs.begin() + to, jobs.end());
+            auto [piece, _] = pieces(segments, piece_jobs, 0, uint32_t(piece_jobs.size()));
+            count(differences, segments.replaced(from, to, piece), RvrpProblem::get_state(route), "replace");
+
+            if (size >= 2) {  // 2-opt
+                uint32_t it1 = random.number(size - 1), it3 = it1 + 1 + random.number(size - it1 - 1);
+                track.jobs = swap(jobs, it1, it3);
+                auto [forward, backward] = pieces(segments, jobs, it1, it3 + 1);
+                count(differences, segments.replaced(it1, it3 + 1, backward), RvrpProblem::get_state(route), "2-opt");
+            }
+
+            if (size >= 4) {  // 3-opt, обмены 0-3 как в three_opt
+                uint32_t it1 = random.number(size - 2);
+                uint32_t it3 = it1 + 1 + random.number(size - it1 - 2);
+                uint32_t it5 = it3 + 1 + random.number(size - it3 - 1);
+                uint32_t exchange = random.number(4);
+                track.jobs = three_opt_exchange(jobs, exchange, it1, it3, it5);
+                auto [b, b_reversed] = pieces(segments, jobs, it1 + 1, it3 + 1);
+                auto [c, c_reversed] = pieces(segments, jobs, it3 + 1, it5 + 1);
+                const Segment *middle[4][2] = {{&c, &b_reversed}, {&c, &b}, {&c_reversed, &b}, {&b_reversed, &c_reversed}};
+                Segment moved = segments.concat(*middle[exchange][0], *middle[exchange][1]);
+                count(differences, segments.replaced(it1 + 1, it5 + 1, moved), RvrpProblem::get_state(route), "3-opt");
+            }
+        }
+
+        // случайный порядок задач целиком
+        track.jobs = jobs;
+        std::shuffle(track.jobs.begin(), track.jobs.end(), random);
+        segments.select(t, track.jobs);
+        count(differences, segments.replaced(0, 0, Segment()), RvrpProblem::get_state(route), "shuffle");
+        track.jobs = jobs;
+        segments.select(t, jobs);
+    }
+
+    // новый подмаршрут из одной задачи на любое место
+    for (int r = 0; r < 10 && !route.courier->storages.empty(); ++r) {
+        uint32_t job = random.number(table.size());
+        std::size_t position = random.number(uint32_t(route.tracks.size() + 1));
+        Track track(job, table.storages[table.storage[job]]);
+        route.tracks.insert(route.tracks.begin() + int64_t(position), track);
+        std::optional full = RvrpProblem::get_state(route);
+        route.tracks.erase(route.tracks.begin() + int64_t(position));
+        count(differences, segments.inserted(position, segments.track(track)), full, "track");
+    }
+}
+
+/**
+ * Вставок/с во все места всех подмаршрутов: через get_state, склейкой с пересчетом кусков на каждую задачу
+ * и склейкой по кускам, посчитанным один раз на маршрут (как в unassigned_insert)
+ */
+std::tuple<double, double, double> insertion_rates(std::vector<Route> &routes, const JobTable &table, int repeats,
+                                           int64_t &checksum) {
+    std::size_t positions = 0;
+    auto start = steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        for (auto &route : routes) {
+            for (auto &track : route.tracks) {
+                JobIds jobs = track.jobs;
+                uint32_t job = uint32_t(r) % table.size();
+                for (uint32_t k = 0; k <= jobs.size(); ++k) {
+                    track.jobs = insert(k, job, jobs);
+                    auto state = RvrpProblem::get_state(route);
+                    checksum += state ? state->travel_time : 0;
+                    ++positions;
+                }
+                track.jobs = jobs;
+            }
+        }
+    }
+    double full = double(positions) / duration<double>(steady_clock::now() - start).count();
+
+    start = steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        for (auto &route : routes) {
+            RouteSegments segments(route);
+            uint32_t job = uint32_t(r) % table.size();
+            Segment piece = segments.job(job);
+            for (std::size_t t = 0; t < route.tracks.size(); ++t) {
+                segments.select(t, route.tracks[t].jobs);
+                for (uint32_t k = 0; k <= route.tracks[t].jobs.size(); ++k) {
+                    auto state = segments.replaced(k, k, piece);
+                    checksum += state ? state->travel_time : 0;
+                }
+            }
+        }
+    }
+    double glued = double(positions) / duration<double>(steady_clock::now() - start).count();
+
+    start = steady_clock::now();
+    std::vector<std::optional<RouteSegments>> cache(routes.size());
+    for (std::size_t i = 0; i < routes.size(); ++i) {
+        cache[i].emplace(routes[i]);
+        cache[i]->select_all();
+    }
+    for (int r = 0; r < repeats; ++r) {
+        uint32_t job = uint32_t(r) % table.size();
+        for (std::size_t i = 0; i < routes.size(); ++i) {
+            RouteSegments &segments = cache[i].value();
+            Segment piece = segments.job(job);
+            for (std::size_t t = 0; t < routes[i].tracks.size(); ++t) {
+                segments.pick(t);
+                if (!segments.fits(piece)) {
+                    continue;
+                }
+                for (uint32_t k = 0; k <= routes[i].tracks[t].jobs.size(); ++k) {
+                    auto state = segments.replaced(k, k, piece);
+                    checksum += state ? state->travel_time : 0;
+                }
+            }
+        }
+    }
+    double cached = double(positions) / duration<double>(steady_clock::now() - start).count();
+    return {full, glued, cached};
+}
+
+int main(int argc, char **argv) {
+    int jobs = argc > 1 ? std::stoi(argv[1]) : 2000;
+    int repeats = argc > 2 ? std::stoi(argv[2]) : 20;
+
+    bool ok = true;
+    for (bool tight : {false, true}) {
+        InstanceConfig config;
+        config.jobs = jobs;
+        config.storages = 3;
+        config.couriers = 10;
+        config.tight_windows = tight;
+        config.heterogeneous = true;
+        config.seed = 29;
+        auto[vec, couriers, storages, matrices] = generate_instance(config);
+        for (auto &courier : couriers) {
+            std::fill(courier->value.begin(), courier->value.end(), jobs);  // длинные маршруты
+        }
+        MadrichEngine engine = RvrpProblem::init_tour(vec, storages, couriers, matrices, true);
+
+        Random random(29);
+        Differences differences;
+        std::size_t usable = 0;
+        for (auto &route : engine.routes) {
+            if (RouteSegments::usable(route)) {
+                ++usable;
+                differential(route, random, differences);
+            }
+        }
+        printf("windows: %s, routes: %zu/%zu usable, jobs: %zu\n", tight ? "tight" : "wide", usable,
+               engine.routes.size(), engine.assigned_jobs());
+        printf("moves: %zu, feasible: %zu, mismatches: %zu\n", differences.moves, differences.feasible,
+               differences.mismatches);
+        ok = ok && differences.mismatches == 0 && usable == engine.routes.size();
+
+        int64_t checksum = 0;
+        double full_rate = 0, glued_rate = 0, cached_rate = 0;
+        for (int round = 0; round < 3; ++round) {  // по очереди, чтобы шум делился поровну
+            auto [full, glued, cached] = insertion_rates(engine.routes, *engine.job_table, repeats, checksum);
+            full_rate = std::max(full_rate, full);
+            glued_rate = std::max(glued_rate, glued);
+            cached_rate = std::max(cached_rate, cached);
+        }
+        printf("insertions/s: get_state %.3g, segments %.3g (x%.1f), cached %.3g (x%.1f)\n", full_rate, glued_rate,
+               glued_rate / full_rate, cached_rate, cached_rate / full_rate);
+        printf("checksum: %jd\n\n", checksum);
+    }
+    if (!ok) {
+        printf("segments mismatch\n");
+        return 1;
+    }
+}
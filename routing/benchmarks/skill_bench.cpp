@@ -0,0 +1,104 @@
+#include <chrono>
+#include <cstdio>
+#include <generators.h>
+#include <local_search/problem.h>
+
+using namespace std::chrono;
+
+
+/**
+ * Проверка умений сравнением строк, как было до SkillSet
+ */
+bool string_covers(const std::vector<std::string> &have, const std::vector<std::string> &required) {
+    return std::ranges::all_of(required, [&have](const std::string &skill) {
+        return std::ranges::find(have, skill) != have.end();
+    });
+}
+
+/**
+ * Случайные от min до max умений из skills первых умений
+ */
+std::vector<std::string> random_skills(Random &random, uint32_t skills, uint32_t min, uint32_t max) {
+    std::vector<std::string> ret;
+    uint32_t count = min + random.number(max - min + 1);
+    while (ret.size() < count) {
+        std::string skill = "skill_" + std::to_string(random.number(skills));
+        if (std::ranges::find(ret, skill) == ret.end()) {
+            ret.push_back(skill);
+        }
+    }
+    return ret;
+}
+
+/**
+ * Курьер x задача: оба способа дают один ответ
+ */
+bool same_answers(const std::vector<Route> &routes, const JobTable &table) {
+    for (const auto &route : routes) {
+        for (uint32_t job = 0; job < table.size(); ++job) {
+            if (RvrpProblem::validate_skills(job, route) !=
+                string_covers(route.courier->skills, table.jobs[job]->skills)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    int repeats = argc > 1 ? std::stoi(argv[1]) : 200;
+
+    InstanceConfig config;
+    config.jobs = 2000;
+    config.storages = 3;
+    config.couriers = 30;
+    config.seed = 11;
+    printf("skills\tsame\tstrings/s\tbits/s\t\tspeedup\n");
+    for (uint32_t skills : {30u, 100u}) {  // 100: часть умений в overflow
+        auto[vec, couriers, storages, matrices] = generate_instance(config);
+        Random random(skills);
+        for (auto &courier : couriers) {
+            courier->skills = random_skills(random, skills, skills * 2 / 3, skills - 2);
+        }
+        for (auto &storage : storages) {
+            for (auto &job : storage->unassigned_jobs) {
+                job->skills = random_skills(random, skills, 0, 3);
+            }
+        }
+        MadrichEngine engine(vec, storages, couriers, matrices, true, true);
+        const JobTable &table = *engine.job_table;
+        bool same = same_answers(engine.routes, table);
+
+        int64_t checksum = 0;
+        double string_rate = 0, bit_rate = 0;
+        double pairs = double(repeats) * double(engine.routes.size()) * double(table.size());
+        for (int round = 0; round < 3; ++round) {  // по очереди, чтобы шум делился поровну
+            auto start = steady_clock::now();
+            for (int r = 0; r < repeats; ++r) {
+                for (const auto &route : engine.routes) {
+                    for (const auto &job : table.jobs) {
+                        checksum += string_covers(route.courier->skills, job->skills);
+                    }
+                }
+            }
+            string_rate = std::max(string_rate, pairs / duration<double>(steady_clock::now() - start).count());
+
+            start = steady_clock::now();
+            for (int r = 0; r < repeats; ++r) {
+                for (const auto &route : engine.routes) {  // номер курьера ищется раз на маршрут, как в операторах
+                    const SkillSet &have = table.courier_skills[table.index(route.courier)];
+                    for (uint32_t job = 0; job < table.size(); ++job) {
+                        checksum += have.covers(table.skills[job]);
+                    }
+                }
+            }
+            bit_rate = std::max(bit_rate, pairs / duration<double>(steady_clock::now() - start).count());
+        }
+        printf("%u\t%d\t%.3g\t\t%.3g\t\tx%.1f\n", skills, same, string_rate, bit_rate, bit_rate / string_rate);
+        if (!same) {
+            printf("answers mismatch\n");
+            return 1;
+        }
+        printf("checksum: %jd\n", checksum);
+    }
+}
@@ -0,0 +1,67 @@
+#include <chrono>
+#include <cstdio>
+#include <new>
+#include <generators.h>
+#include <local_search/problem.h>
+
+using namespace std::chrono;
+
+static std::size_t allocations = 0;  // счетчик operator new на весь процесс
+
+void *operator new(std::size_t size) {
+    ++allocations;
+    if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+
+int main(int argc, char **argv) {
+    int repeats = argc > 1 ? std::stoi(argv[1]) : 2000;
+    auto[vec, couriers, storages, matrices] = generate_rvrp(100, 3, 5, 1);
+    MadrichEngine engine = RvrpProblem::init_tour(vec, storages, couriers, matrices, true);
+
+    std::size_t legs = 0;
+    for (const auto &route : engine.routes) {
+        for (const auto &track : route.tracks) {
+            legs += track.jobs.size() + 2;
+        }
+    }
+
+    int feasible = 0;
+    std::size_t before = allocations;
+    auto start = steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        for (const auto &route : engine.routes) {
+            feasible += RvrpProblem::get_state(route).has_value();
+        }
+    }
+    double elapsed = duration<double>(steady_clock::now() - start).count();
+    std::size_t calls = std::size_t(repeats) * engine.routes.size();
+    double per_call = double(allocations - before) / double(calls);
+
+    before = allocations;
+    for (int r = 0; r < repeats; ++r) {
+        for (const auto &route : engine.routes) {
+            for (const auto &track : route.tracks) {
+                feasible += RvrpProblem::get_state_track(track, route).travel_time > 0;
+            }
+        }
+    }
+    double per_track = double(allocations - before) / double(repeats) / double(legs);
+
+    printf("\nsizeof(State): %zu, trivially copyable: %d\n", sizeof(State), std::is_trivially_copyable_v<State>);
+    printf("get_state: %.0f calls/s, %.2f allocations per call (%.2f per leg)\n",
+           double(calls) / elapsed, per_call, per_call * double(engine.routes.size()) / double(legs));
+    printf("get_state_track: %.2f allocations per leg\n", per_track);
+    printf("feasible: %d\n", feasible);
+}
@@ -0,0 +1,54 @@
+#include <chrono>
+#include <generators.h>
+#include <benchmarks/bench_utils.h>
+#include <local_search/engine.h>
+
+using namespace std::chrono;
+
+
+/**
+ * Нагрузка HvrpRunner (вставки, затем improve), но с фиксированными фазами и сидом, чтобы сравнивать прогоны
+ * @param capacity память оценок (0: без нее)
+ * @return время, итоговая оценка тура
+ */
+std::tuple<double, State> run(int vec, const Storages &storages, const Couriers &couriers,
+                              std::map<std::string, Matrix> &matrices, std::size_t capacity, uint32_t phases) {
+    auto[storages_copy, couriers_copy] = copy_instance(storages, couriers);
+    MadrichEngine engine(vec, storages_copy, couriers_copy, matrices, true, true);
+    engine.cache_states(capacity);
+    engine.seed(11);
+    auto start = steady_clock::now();
+    engine.build_tour();
+    engine.improve(0, 5, phases, true, true);
+    double elapsed = duration<double>(steady_clock::now() - start).count();
+    State state = engine.get_state();
+    fprintf(stderr, "capacity %zu: %.2f s, assigned: %zu, cost: %.1f\n", capacity, elapsed, engine.assigned_jobs(),
+            state.cost);
+    if (capacity) {
+        engine.cache_report();
+    }
+    return {elapsed, state};
+}
+
+int main(int argc, char **argv) {
+    int jobs = argc > 1 ? std::stoi(argv[1]) : 70;
+    uint32_t phases = argc > 2 ? std::stoi(argv[2]) : 8;
+
+    for (bool split : {false, true}) {
+        auto[vec, couriers, storages, matrices] = generate_rvrp(jobs, 3, 5, 1);
+        if (split) {
+            split_windows(storages);
+        }
+        fprintf(stderr, "windows per job: %d\n", split ? 2 : 1);
+        auto [plain, plain_state] = run(vec, storages, couriers, matrices, 0, phases);
+        for (std::size_t capacity : {std::size_t(1) << 10, std::size_t(1) << 16}) {  // маленькая - с вытеснением
+            auto [cached, cached_state] = run(vec, storages, couriers, matrices, capacity, phases);
+            if (cached_state.travel_time != plain_state.travel_time || cached_state.distance != plain_state.distance ||
+                cached_state.cost != plain_state.cost) {
+                printf("cache changed the result\n");
+                return 1;
+            }
+            fprintf(stderr, "capacity %zu: speedup x%.2f\n", capacity, plain / cached);
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#include <chrono>
+#include <cmath>
+#include <generators.h>
+#include <local_search/problem.h>
+
+using namespace std::chrono;
+
+constexpr uint32_t SLICES = 96;  // сутки по 15 минут
+constexpr uint32_t DISCRETENESS = 900;
+
+
+/**
+ * Срезы с утренним и вечерним пиком поверх статической матрицы
+ */
+Matrix rush_hour(const Matrix &matrix, time_t day_start, bool interpolation) {
+    uint32_t size = matrix.dimension();
+    std::vector distance(SLICES, std::vector<std::vector<int>>(size, std::vector<int>(size)));
+    std::vector travel_time(SLICES, std::vector<std::vector<time_t>>(size, std::vector<time_t>(size)));
+    for (uint32_t k = 0; k < SLICES; ++k) {
+        double hour = k * DISCRETENESS / 3600.;
+        double factor = 1 + 0.6 * std::exp(-std::pow(hour - 8.5, 2)) + 0.8 * std::exp(-std::pow(hour - 18, 2));
+        for (uint32_t i = 0; i < size; ++i) {
+            for (uint32_t j = 0; j < size; ++j) {
+                distance[k][i][j] = matrix.get_distance(i, j);
+                travel_time[k][i][j] = time_t(double(matrix.get_time(i, j)) * factor);
+            }
+        }
+    }
+    return Matrix(matrix.profile, distance, travel_time, DISCRETENESS, day_start, day_start + SLICES * DISCRETENESS,
+                  MatrixLayout::Flat, interpolation);
+}
+
+/**
+ * Оценка всех маршрутов repeats раз, возвращает оценок маршрута в секунду
+ */
+double evaluate(std::vector<Route> &routes, const ptrMatrix &matrix, int repeats, int &feasible) {
+    for (auto &route : routes) {
+        route.matrix = matrix;
+    }
+    auto start = steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        for (const auto &route : routes) {
+            feasible += RvrpProblem::get_state(route).has_value();
+        }
+    }
+    double elapsed = duration<double>(steady_clock::now() - start).count();
+    return double(repeats) * double(routes.size()) / elapsed;
+}
+
+int main(int argc, char **argv) {
+    int repeats = argc > 1 ? std::stoi(argv[1]) : 2000;
+    auto[vec, couriers, storages, matrices] = generate_rvrp(100, 3, 5);
+    MadrichEngine engine = RvrpProblem::init_tour(vec, storages, couriers, matrices, true);
+
+    const Matrix &matrix = matrices["driver"];
+    time_t day_start = engine.routes[0].start_time - 10 * 3600;  // смены начинаются в 10 утра
+    auto static_matrix = std::make_shared<const Matrix>(matrix);
+    auto step_matrix = std::make_shared<const Matrix>(rush_hour(matrix, day_start, false));
+    auto linear_matrix = std::make_shared<const Matrix>(rush_hour(matrix, day_start, true));
+
+    int feasible = 0;
+    double static_rate = evaluate(engine.routes, static_matrix, repeats, feasible);
+    double step_rate = evaluate(engine.routes, step_matrix, repeats, feasible);
+    double linear_rate = evaluate(engine.routes, linear_matrix, repeats, feasible);
+    printf("\nstatic:       %.0f get_state/s\n", static_rate);
+    printf("slices:       %.0f get_state/s (overhead %.1f%%)\n", step_rate, 100 * (static_rate / step_rate - 1));
+    printf("interpolated: %.0f get_state/s (overhead %.1f%%)\n", linear_rate, 100 * (static_rate / linear_rate - 1));
+    printf("feasible: %d\n", feasible);
+}
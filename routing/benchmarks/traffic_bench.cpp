@@ -0,0 +1,88 @@
+#include <chrono>
+#include <cstdio>
+#include <generators.h>
+
+using namespace std::chrono;
+
+constexpr std::size_t LOOKUPS = 1 << 22;
+
+
+/**
+ * FIFO на случайных парах: выезд на секунду позже не дает приезда раньше, в том числе на границах срезов
+ */
+bool check_fifo(const Matrix &matrix, time_t start, time_t end) {
+    Random random(3);
+    for (int n = 0; n < 2000; ++n) {
+        uint32_t src = random.number(matrix.dimension()), dst = random.number(matrix.dimension());
+        time_t arrival = 0;
+        for (time_t t = start; t < end; t += 60) {
+            time_t next = t + matrix.get_time(src, dst, t);
+            if (next < arrival) {
+                return false;
+            }
+            arrival = next;
+        }
+    }
+    return true;
+}
+
+/**
+ * нс на get_time в случайный момент дня
+ */
+double lookup(const Matrix &matrix, time_t start, time_t period, int64_t &checksum) {
+    Random random(5);
+    std::vector<uint32_t> src(LOOKUPS), dst(LOOKUPS);
+    std::vector<time_t> moment(LOOKUPS);
+    for (std::size_t i = 0; i < LOOKUPS; ++i) {
+        src[i] = random.number(matrix.dimension());
+        dst[i] = random.number(matrix.dimension());
+        moment[i] = start + time_t(random.number(uint32_t(period)));
+    }
+    auto begin = steady_clock::now();
+    for (std::size_t i = 0; i < LOOKUPS; ++i) {
+        checksum += matrix.get_time(src[i], dst[i], moment[i]);
+    }
+    return duration<double, std::nano>(steady_clock::now() - begin).count() / LOOKUPS;
+}
+
+int main(int argc, char **argv) {
+    int points_count = argc > 1 ? std::stoi(argv[1]) : 1000;
+    uint32_t slices = argc > 2 ? std::stoul(argv[2]) : 96;
+    std::vector points = generate_points(points_count);
+
+    TrafficConfig config;
+    config.slices = slices;
+    auto[day_start, day_end] = Window("2020-10-01T00:00:00Z", "2020-10-02T00:00:00Z").window;
+    config.start_time = day_start;
+    time_t period = time_t(slices) * config.discreteness;
+
+    {
+        config.interpolation = true;
+        config.layout = MatrixLayout::Quantized;
+        Matrix fifo = generate_traffic_matrix("driver", points, config);
+        printf("points: %d, slices: %u, fifo: %s\n\n", points_count, slices,
+               check_fifo(fifo, day_start, day_start + period) ? "ok" : "broken");
+        config.interpolation = false;
+    }
+
+    int64_t checksum = 0;
+    Matrix single = generate_matrix("driver", points);
+    printf("layout\t\tbuild (s)\tMB\tns/get_time\n");
+    printf("1 slice\t\t-\t\t%.1f\t%.1f\n", double(single.memory_usage()) / (1 << 20),
+           lookup(single, day_start, period, checksum));
+    const std::pair<MatrixLayout, const char *> layouts[] = {
+            {MatrixLayout::Flat,        "Flat"},
+            {MatrixLayout::Interleaved, "Interleaved"},
+            {MatrixLayout::Symmetric,   "Symmetric"},
+            {MatrixLayout::Quantized,   "Quantized"},
+    };
+    for (auto[layout, name] : layouts) {
+        config.layout = layout;
+        auto begin = steady_clock::now();
+        Matrix matrix = generate_traffic_matrix("driver", points, config);
+        double build = duration<double>(steady_clock::now() - begin).count();
+        printf("%s%s\t%.2f\t\t%.1f\t%.1f\n", name, std::string(name).size() < 8 ? "\t" : "", build,
+               double(matrix.memory_usage()) / (1 << 20), lookup(matrix, day_start, period, checksum));
+    }
+    printf("checksum: %jd\n", checksum);
+}
@@ -0,0 +1,130 @@
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <base_model.h>
+
+using namespace std::chrono;
+
+
+/**
+ * Разбор через istringstream и get_time, как было до parse_time (mktime заменен на timegm, чтобы сравнивать в UTC)
+ */
+time_t stream_time(const std::string &time) {
+    std::tm t{};
+    std::istringstream ss(time);
+    ss >> std::get_time(&t, "%Y-%m-%dT%H:%M:%SZ");
+    return timegm(&t);
+}
+
+/**
+ * Случайный момент 1990-2040 в секундах UTC
+ */
+time_t random_moment(Random &random) {
+    return time_t(631152000) + time_t(random.number(50u * 365 * 86400));
+}
+
+/**
+ * Момент строкой: format 0 - Z, 1 - доли секунды, 2 - +HH:MM, 3 - -HHMM, 4 - без смещения через пробел
+ */
+std::string format_time(time_t moment, uint32_t format, Random &random) {
+    int offset = format == 2 || format == 3 ? int(random.number(14 * 4)) * 15 * 60 : 0;
+    if (format == 3) {
+        offset = -offset;
+    }
+    time_t local = moment + offset;
+    std::tm t{};
+    gmtime_r(&local, &t);
+    char buffer[64];
+    std::size_t size = std::strftime(buffer, sizeof(buffer), format == 4 ? "%Y-%m-%d %H:%M:%S" : "%Y-%m-%dT%H:%M:%S", &t);
+    std::string ret(buffer, size);
+    int hours = std::abs(offset) / 3600, minutes = std::abs(offset) % 3600 / 60;
+    char sign = offset < 0 ? '-' : '+';
+    switch (format) {
+        case 0:
+            return ret + "Z";
+        case 1:
+            return ret + "." + std::to_string(random.number(1000)) + "Z";
+        case 2:
+            snprintf(buffer, sizeof(buffer), "%c%02d:%02d", sign, hours, minutes);
+            return ret + buffer;
+        case 3:
+            snprintf(buffer, sizeof(buffer), "%c%02d%02d", sign, hours, minutes);
+            return ret + buffer;
+        default:
+            return ret;
+    }
+}
+
+/**
+ * Строки, которые parse_time должен отвергнуть
+ */
+bool rejects_malformed() {
+    for (const char *time : {"", "2020-10-01", "2020-10-01T10:00", "2020-13-01T10:00:00Z", "2021-02-29T10:00:00Z",
+                             "2020-10-01T24:00:00Z", "2020-10-01T10:00:00.Z", "2020-10-01T10:00:00+5",
+                             "2020-10-01T10:00:00Zx", "2020/10/01T10:00:00Z", "2020-10-01T1a:00:00Z"}) {
+        try {
+            parse_time(time);
+            printf("accepted: '%s'\n", time);
+            return false;
+        } catch (const std::invalid_argument &) {
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    int windows = argc > 1 ? std::stoi(argv[1]) : 100000;
+
+    Random random(23);
+    std::vector<std::tuple<std::string, std::string>> zulu, mixed;
+    std::vector<std::tuple<time_t, time_t>> expected;
+    zulu.reserve(windows);
+    mixed.reserve(windows);
+    for (int i = 0; i < windows; ++i) {
+        time_t start = random_moment(random), end = start + time_t(random.number(8 * 3600));
+        zulu.emplace_back(format_time(start, 0, random), format_time(end, 0, random));
+        mixed.emplace_back(format_time(start, random.number(5), random), format_time(end, random.number(5), random));
+        expected.emplace_back(start, end);
+    }
+
+    bool same = rejects_malformed();
+    auto parsed = parse_windows(mixed);
+    for (int i = 0; i < windows && same; ++i) {
+        same = parsed[i].window == expected[i] && parse_time(std::get<0>(zulu[i])) == std::get<0>(expected[i]) &&
+               stream_time(std::get<0>(zulu[i])) == std::get<0>(expected[i]);
+    }
+    if (!same) {
+        printf("parse mismatch\n");
+        return 1;
+    }
+
+    int64_t checksum = 0;
+    double stream_rate = 0, parse_rate = 0, bulk_rate = 0;
+    double strings = 2. * windows;
+    for (int round = 0; round < 3; ++round) {  // по очереди, чтобы шум делился поровну
+        auto start = steady_clock::now();
+        for (const auto &[start_t, end_t] : zulu) {
+            checksum += stream_time(end_t) - stream_time(start_t);
+        }
+        stream_rate = std::max(stream_rate, strings / duration<double>(steady_clock::now() - start).count());
+
+        start = steady_clock::now();
+        for (const auto &[start_t, end_t] : zulu) {
+            auto[first, last] = Window(start_t, end_t).window;
+            checksum += last - first;
+        }
+        parse_rate = std::max(parse_rate, strings / duration<double>(steady_clock::now() - start).count());
+
+        start = steady_clock::now();
+        for (const auto &window : parse_windows(mixed)) {
+            checksum += std::get<1>(window.window) - std::get<0>(window.window);
+        }
+        bulk_rate = std::max(bulk_rate, strings / duration<double>(steady_clock::now() - start).count());
+    }
+    printf("windows: %d\n", windows);
+    printf("stream/s\tparse_time/s\tparse_windows/s\tspeedup\n%.3g\t\t%.3g\t\t%.3g\t\tx%.1f\n",
+           stream_rate, parse_rate, bulk_rate, parse_rate / stream_rate);
+    printf("checksum: %jd\n", checksum);
+}
@@ -0,0 +1,157 @@
+#include <chrono>
+#include <cstdio>
+#include <generators.h>
+#include <local_search/operators/route_utils.h>
+#include <local_search/problem.h>
+
+using namespace std::chrono;
+
+
+/**
+ * Одинаковые оценки: время и расстояние точно, стоимость - до округления float (tolerance = 0: точно)
+ */
+bool same(const std::optional<State> &lhs, const std::optional<State> &rhs, float tolerance) {
+    if (!lhs || !rhs) {
+        return !lhs && !rhs;
+    }
+    return lhs->travel_time == rhs->travel_time && lhs->distance == rhs->distance &&
+           std::abs(lhs->cost - rhs->cost) <= tolerance * std::max(1.f, std::abs(rhs->cost));
+}
+
+/**
+ * Разворот [it1, it3] подмаршрута за O(1), как в two_opt
+ */
+std::optional<State> reversal(const Route &route, const Track &track, const State &state, uint32_t it1, uint32_t it3) {
+    const JobTable &table = *route.job_table;
+    int before = it1 == 0 ? track.storage->location.matrix_id : table.location[track.jobs[it1 - 1]];
+    int after = it3 + 1 == track.jobs.size() ? track_exit(track, route) : table.location[track.jobs[it3 + 1]];
+    return RvrpProblem::reversed(route, state, before, table.location[track.jobs[it1]],
+                                 table.location[track.jobs[it3]], after);
+}
+
+/**
+ * Случайные изменения маршрутов: evaluate_free против evaluate_windows, разворот за O(1) против полной оценки
+ * @return кол-во расхождений
+ */
+std::size_t differential(std::vector<Route> &routes, RouteEvaluator windows, RouteEvaluator free, Random &random,
+                         std::size_t &moves) {
+    std::size_t mismatches = 0;
+    for (auto &route : routes) {
+        const JobTable &table = *route.job_table;
+        State state = windows(route).value();
+        for (auto &track : route.tracks) {
+            JobIds jobs = track.jobs;
+            auto size = uint32_t(jobs.size());
+            for (int r = 0; r < 20 && size >= 2; ++r) {
+                uint32_t it1 = random.number(size - 1), it3 = it1 + 1 + random.number(size - it1 - 1);
+                track.jobs = swap(jobs, it1, it3);
+                std::optional full = windows(route);
+                mismatches += !same(free(route), full, 0);
+                track.jobs = jobs;
+                mismatches += !same(reversal(route, track, state, it1, it3), full, 1e-5f);
+
+                // любая задача на любое место: перевес, чужие склады и умения, конец смены
+                track.jobs = insert(random.number(size + 1), random.number(table.size()), jobs);
+                mismatches += !same(free(route), windows(route), 0);
+                std::shuffle(track.jobs.begin(), track.jobs.end(), random);
+                mismatches += !same(free(route), windows(route), 0);
+                track.jobs = jobs;
+                moves += 4;
+            }
+        }
+    }
+    return mismatches;
+}
+
+/**
+ * Оценок маршрутов в секунду
+ */
+double evaluations_rate(const std::vector<Route> &routes, RouteEvaluator evaluator, int repeats, int64_t &checksum) {
+    auto start = steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        for (const auto &route : routes) {
+            auto state = evaluator(route);
+            checksum += state ? state->travel_time : -1;
+        }
+    }
+    return double(repeats) * double(routes.size()) / duration<double>(steady_clock::now() - start).count();
+}
+
+/**
+ * Ходов 2-opt в секунду по всем парам (it1, it3) всех подмаршрутов: полной оценкой или разворотом за O(1)
+ */
+double two_opt_rate(std::vector<Route> &routes, RouteEvaluator evaluator, bool reversed, int64_t &checksum) {
+    std::size_t moves = 0;
+    auto start = steady_clock::now();
+    for (auto &route : routes) {
+        for (auto &track : route.tracks) {
+            JobIds jobs = track.jobs;
+            auto size = uint32_t(jobs.size());
+            for (uint32_t it1 = 0; it1 < size; ++it1) {
+                for (uint32_t it3 = it1 + 1; it3 < size; ++it3) {
+                    std::optional<State> state;
+                    if (reversed) {
+                        state = reversal(route, track, route.state, it1, it3);
+                    } else {
+                        track.jobs = swap(jobs, it1, it3);
+                        state = evaluator(route);
+                        track.jobs = jobs;
+                    }
+                    checksum += state ? state->distance : -1;
+                    ++moves;
+                }
+            }
+        }
+    }
+    return double(moves) / duration<double>(steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+    int jobs = argc > 1 ? std::stoi(argv[1]) : 5000;
+    int repeats = argc > 2 ? std::stoi(argv[2]) : 20;
+
+    int64_t checksum = 0;
+    for (bool circle_track : {true, false}) {
+        InstanceConfig config;
+        config.jobs = jobs;
+        config.storages = 4;
+        config.couriers = 20;
+        config.window_free = true;
+        config.seed = 31;
+        auto[vec, couriers, storages, matrices] = generate_instance(config);
+        MadrichEngine engine = RvrpProblem::init_tour(vec, storages, couriers, matrices, circle_track);
+        RouteEvaluator windows = circle_track ? &RvrpProblem::evaluate_windows<0, true>
+                                              : &RvrpProblem::evaluate_windows<0, false>;
+        RouteEvaluator free = circle_track ? &RvrpProblem::evaluate_free<0, true>
+                                           : &RvrpProblem::evaluate_free<0, false>;
+
+        std::size_t window_free = 0, symmetric = 0;
+        for (const auto &route : engine.routes) {
+            window_free += RvrpProblem::window_free(route);
+            symmetric += route.symmetric;
+        }
+        Random random(31);
+        std::size_t moves = 0;
+        std::size_t mismatches = differential(engine.routes, windows, free, random, moves);
+        printf("circle_track: %d, jobs: %zu/%d, window free routes: %zu/%zu, symmetric: %zu\n", circle_track,
+               engine.assigned_jobs(), jobs, window_free, engine.routes.size(), symmetric);
+        printf("moves: %zu, mismatches: %zu\n", moves, mismatches);
+        if (mismatches != 0 || window_free != engine.routes.size() || symmetric != engine.routes.size()) {
+            printf("window free mismatch\n");
+            return 1;
+        }
+
+        double windows_rate = 0, free_rate = 0, full_moves = 0, reversed_moves = 0;
+        for (int round = 0; round < 3; ++round) {  // по очереди, чтобы шум делился поровну
+            windows_rate = std::max(windows_rate, evaluations_rate(engine.routes, windows, repeats, checksum));
+            free_rate = std::max(free_rate, evaluations_rate(engine.routes, free, repeats, checksum));
+            full_moves = std::max(full_moves, two_opt_rate(engine.routes, free, false, checksum));
+            reversed_moves = std::max(reversed_moves, two_opt_rate(engine.routes, free, true, checksum));
+        }
+        printf("evaluations/s: windows %.3g, window free %.3g, x%.1f\n", windows_rate, free_rate,
+               free_rate / windows_rate);
+        printf("2-opt moves/s: evaluate_free %.3g, reversed %.3g, x%.1f\n\n", full_moves, reversed_moves,
+               reversed_moves / full_moves);
+    }
+    printf("checksum: %jd\n", checksum);
+}
@@ -8,6 +8,7 @@ int main() {
     auto[vec, couriers, storages, matrix] = generate_rvrp(70, 3, 5);
     printf("Building...\n");
     MadrichEngine tour = MadrichEngine(vec, storages, couriers, matrix, true, true);
+    tour.cache_states();
     tour.build_tour();
 
     for (const auto &route : tour.routes) {
@@ -24,4 +25,6 @@ int main() {
     tour.improve(10, 5, 0, false, false);
     auto state = tour.get_state();
     state.print();
+    tour.cache_report();
+    tour.screen_report();
 }
@@ -1,5 +1,9 @@
 #include "generators.h"
 
+#ifdef MADRICH_X86_SIMD
+#include <immintrin.h>
+#endif
+
 
 #define earthRadiusKm 6371.0
 
@@ -27,35 +31,147 @@ double distanceEarth(double lat1d, double lon1d, double lat2d, double lon2d) {
     return earthRadiusKm * asin(sqrt(u * u + cos(lat1r) * cos(lat2r) * v * v)) * 2e3;
 }
 
-float generate_value() {
-    std::random_device rd;
-    std::mt19937 mersenne(rd());
-    return static_cast<float>(mersenne()) / static_cast<float>(UINT32_MAX);
+/**
+ * Синусы и косинусы координат точек, по массиву на каждую величину
+ */
+struct PointsTrig {
+    std::vector<double> sin_lat, cos_lat, sin_lon, cos_lon;
+};
+
+/**
+ * asin на [0, 1]: ряд Тейлора на [0, 0.5], выше asin(x) = pi/2 - 2 asin(sqrt((1 - x) / 2));
+ * коэффициенты (2k)! / (4^k (k!)^2 (2k + 1)) при x^(2k + 1), 15 членов после x дают ошибку ~1e-12
+ */
+constexpr double ASIN_SERIES[] = {
+        1.0 / 6, 3.0 / 40, 15.0 / 336, 105.0 / 3456, 945.0 / 42240, 10395.0 / 599040,
+        135135.0 / 9676800, 2027025.0 / 175472640, 34459425.0 / 3530096640,
+        654729075.0 / 78033715200, 13749310575.0 / 1880240947200,
+        316234143225.0 / 49049763840000, 7905853580625.0 / 1377317368627200,
+        5014575.0 / 973078528, 9694845.0 / 2080374784,
+};
+
+#ifdef MADRICH_X86_SIMD
+
+__attribute__((target("avx2")))
+__m256d asin_avx2(__m256d x) {
+    const __m256d half = _mm256_set1_pd(0.5);
+    __m256d big = _mm256_cmp_pd(x, half, _CMP_GT_OQ);
+    __m256d z = _mm256_blendv_pd(x, _mm256_sqrt_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_set1_pd(1), x), half)), big);
+    __m256d z2 = _mm256_mul_pd(z, z);
+    __m256d poly = _mm256_set1_pd(ASIN_SERIES[std::size(ASIN_SERIES) - 1]);
+    for (int k = int(std::size(ASIN_SERIES)) - 2; k >= 0; --k) {
+        poly = _mm256_add_pd(_mm256_mul_pd(poly, z2), _mm256_set1_pd(ASIN_SERIES[k]));
+    }
+    __m256d result = _mm256_add_pd(z, _mm256_mul_pd(_mm256_mul_pd(z, z2), poly));
+    __m256d reflected = _mm256_sub_pd(_mm256_set1_pd(M_PI_2), _mm256_add_pd(result, result));
+    return _mm256_blendv_pd(result, reflected, big);
 }
 
-bool generate_bool() {
-    std::mt19937_64 rng((std::random_device()) ());
-    std::uniform_int_distribution<int> uni(0, 1);
-    return bool(uni(rng));
+/**
+ * Строка src по 4 точки назначения; возвращает, сколько точек посчитано (хвост - обычным циклом)
+ */
+__attribute__((target("avx2")))
+uint32_t haversine_row_avx2(const PointsTrig &trig, double speed_ms, uint32_t src, time_t *times, int *distances) {
+    auto size = uint32_t(trig.sin_lat.size());
+    const __m256d sin_lat = _mm256_set1_pd(trig.sin_lat[src]);
+    const __m256d cos_lat = _mm256_set1_pd(trig.cos_lat[src]);
+    const __m256d sin_lon = _mm256_set1_pd(trig.sin_lon[src]);
+    const __m256d cos_lon = _mm256_set1_pd(trig.cos_lon[src]);
+    const __m256d one = _mm256_set1_pd(1);
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d meters = _mm256_set1_pd(earthRadiusKm * 2e3);
+    const __m256d speed = _mm256_set1_pd(speed_ms);
+    uint32_t j = 0;
+    for (; j + 4 <= size; j += 4) {
+        __m256d dst_cos_lat = _mm256_loadu_pd(trig.cos_lat.data() + j);
+        // cos(a - b) = cos a cos b + sin a sin b
+        __m256d cos_dlat = _mm256_add_pd(_mm256_mul_pd(cos_lat, dst_cos_lat),
+                                         _mm256_mul_pd(sin_lat, _mm256_loadu_pd(trig.sin_lat.data() + j)));
+        __m256d cos_dlon = _mm256_add_pd(_mm256_mul_pd(cos_lon, _mm256_loadu_pd(trig.cos_lon.data() + j)),
+                                         _mm256_mul_pd(sin_lon, _mm256_loadu_pd(trig.sin_lon.data() + j)));
+        // sin^2(d / 2) = (1 - cos d) / 2
+        __m256d h = _mm256_mul_pd(half, _mm256_add_pd(
+                _mm256_sub_pd(one, cos_dlat),
+                _mm256_mul_pd(_mm256_mul_pd(cos_lat, dst_cos_lat), _mm256_sub_pd(one, cos_dlon))));
+        h = _mm256_min_pd(_mm256_max_pd(h, _mm256_setzero_pd()), one);
+        __m256d distance = _mm256_mul_pd(meters, asin_avx2(_mm256_sqrt_pd(h)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(distances + j), _mm256_cvttpd_epi32(distance));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(times + j),
+                            _mm256_cvtepi32_epi64(_mm256_cvttpd_epi32(_mm256_div_pd(distance, speed))));
+    }
+    return j;
+}
+
+#endif
+
+MatrixRow haversine_rows(const std::vector<std::tuple<float, float>> &points, double speed) {
+    auto trig = std::make_shared<PointsTrig>();
+    for (const auto &[lat, lon] : points) {
+        double lat_r = deg2rad(lat), lon_r = deg2rad(lon);
+        trig->sin_lat.push_back(sin(lat_r));
+        trig->cos_lat.push_back(cos(lat_r));
+        trig->sin_lon.push_back(sin(lon_r));
+        trig->cos_lon.push_back(cos(lon_r));
+    }
+    return [trig, speed](uint32_t src, time_t *times, int *distances) {
+        auto size = uint32_t(trig->sin_lat.size());
+        uint32_t j = 0;
+#ifdef MADRICH_X86_SIMD
+        if (cpu_has_avx2()) {
+            j = haversine_row_avx2(*trig, speed, src, times, distances);
+        }
+#endif
+        for (; j < size; ++j) {
+            double cos_dlat = trig->cos_lat[src] * trig->cos_lat[j] + trig->sin_lat[src] * trig->sin_lat[j];
+            double cos_dlon = trig->cos_lon[src] * trig->cos_lon[j] + trig->sin_lon[src] * trig->sin_lon[j];
+            double h = 0.5 * ((1 - cos_dlat) + trig->cos_lat[src] * trig->cos_lat[j] * (1 - cos_dlon));
+            double value = earthRadiusKm * 2e3 * asin(sqrt(std::clamp(h, 0.0, 1.0)));
+            distances[j] = int(value);
+            times[j] = time_t(value / speed);
+        }
+    };
 }
 
-int generate_number(int max) {
-    std::random_device rd;
-    std::mt19937_64 rng(rd());
-    std::uniform_int_distribution<int> uni(0, max - 1);
-    return uni(rng);
+Matrix generate_matrix(const std::string &profile,
+                       const std::vector<std::tuple<float, float>> &points,
+                       MatrixLayout layout,
+                       uint32_t threads,
+                       double speed) {
+    return Matrix(profile, uint32_t(points.size()), haversine_rows(points, speed), layout, threads);
 }
 
-std::tuple<float, float> generate_tuple() {
-    return {generate_value(), generate_value()};
+Random &default_random() {
+    thread_local Random random;
+    return random;
 }
 
-std::vector<std::tuple<float, float>> generate_points(int n, float min_x, float max_x, float min_y, float max_y) {
+void generate_seed(uint64_t seed) {
+    default_random().seed(seed);
+}
+
+float generate_value(Random &random) {
+    return random.value();
+}
+
+bool generate_bool(Random &random) {
+    return random.boolean();
+}
+
+int generate_number(int max, Random &random) {
+    return int(random.number(uint32_t(max)));
+}
+
+std::tuple<float, float> generate_tuple(Random &random) {
+    return {random.value(), random.value()};
+}
+
+std::vector<std::tuple<float, float>>
+generate_points(int n, float min_x, float max_x, float min_y, float max_y, Random &random) {
     float diff_x = max_x - min_x;
     float diff_y = max_y - min_y;
     std::vector ret = std::vector<std::tuple<float, float>>(n);
     for (auto &point : ret) {
-        auto[x, y] = generate_tuple();
+        auto[x, y] = generate_tuple(random);
         x = x * diff_x + min_x;
         y = y * diff_y + min_y;
         point = std::tuple(x, y);
@@ -93,15 +209,77 @@ std::vector<std::vector<time_t>> generate_time(const std::vector<std::tuple<floa
     return matrix;
 }
 
+MatrixRow traffic_rows(const std::vector<std::tuple<float, float>> &points, const TrafficConfig &config) {
+    auto size = uint32_t(points.size());
+    MatrixRow base = haversine_rows(points, config.speed);
+
+    auto weights = std::make_shared<std::vector<double>>(size);
+    Random random(config.seed);
+    for (auto &weight : *weights) {
+        weight = 1 + config.spread * (2 * double(random.value()) - 1);
+    }
+    double max_weight = 1 + std::max(0.f, config.spread);
+
+    // самая долгая поездка без пробок, сверху: d(i, j) <= d(0, i) + d(0, j), +1 м на округление каждого
+    double max_base = 0;
+    if (size > 0) {
+        std::vector<time_t> times(size);
+        std::vector<int> distances(size);
+        base(0, times.data(), distances.data());
+        max_base = (2 * double(*std::max_element(distances.begin(), distances.end())) + 2) / config.speed;
+    }
+
+    tm utc{};
+    gmtime_r(&config.start_time, &utc);
+    double day_offset = utc.tm_hour * 3600 + utc.tm_min * 60 + utc.tm_sec;
+    auto factors = std::make_shared<std::vector<double>>(config.slices);
+    for (uint32_t k = 0; k < config.slices; ++k) {
+        double hour = std::fmod((day_offset + (k + 0.5) * config.discreteness) / 3600, 24);
+        double morning = (hour - config.morning_hour) / config.peak_width;
+        double evening = (hour - config.evening_hour) / config.peak_width;
+        (*factors)[k] = 1 + config.morning_peak * std::exp(-morning * morning)
+                        + config.evening_peak * std::exp(-evening * evening);
+    }
+    // FIFO: за срез множитель падает не больше, чем на discreteness самой долгой и самой загруженной поездки;
+    // пик не срезается, а рассасывается дольше
+    double max_drop = max_base > 0 ? config.discreteness / (max_base * max_weight) : INFINITY;
+    for (uint32_t k = 1; k < config.slices; ++k) {
+        (*factors)[k] = std::max((*factors)[k], (*factors)[k - 1] - max_drop);
+    }
+
+    double speed = config.speed;
+    return [base, weights, factors, speed, size](uint32_t src, time_t *times, int *distances) {
+        base(src, times, distances);  // первый срез - пока строка без пробок, он пересчитывается последним
+        for (auto k = uint32_t(factors->size()); k-- > 0;) {
+            time_t *slice_times = times + std::size_t(k) * size;
+            int *slice_distances = distances + std::size_t(k) * size;
+            double congestion = (*factors)[k] - 1;
+            for (uint32_t j = 0; j < size; ++j) {
+                double factor = 1 + congestion * ((*weights)[src] + (*weights)[j]) / 2;
+                slice_distances[j] = distances[j];
+                slice_times[j] = time_t(distances[j] / speed * factor);
+            }
+        }
+    };
+}
+
+Matrix generate_traffic_matrix(const std::string &profile,
+                               const std::vector<std::tuple<float, float>> &points,
+                               const TrafficConfig &config) {
+    return Matrix(profile, uint32_t(points.size()), config.slices, traffic_rows(points, config),
+                  config.discreteness, config.start_time,
+                  config.start_time + time_t(config.slices) * config.discreteness,
+                  config.layout, config.interpolation, config.threads);
+}
+
 Jobs generate_jobs(const std::vector<Point> &points, int start, int end, const std::string &storage_id) {
     int size = end - start;
     Jobs jobs(size);
+    // окна 10-12, 11-13, 12-14, 13-15: строка разбирается один раз, дальше сдвиг на часы
+    auto[first_start, first_end] = Window("2020-10-01T10:00:00Z", "2020-10-01T12:00:00Z").window;
     for (int i = 0; i < size; ++i) {
-        std::ostringstream start_t;
-        std::ostringstream end_t;
-        start_t << "2020-10-01T" << 10 + (i % 4) << ":00:00Z";
-        end_t << "2020-10-01T" << 12 + (i % 4) << ":00:00Z";
-        Window window = Window(start_t.str(), end_t.str());
+        time_t shift = 3600 * (i % 4);
+        Window window(std::tuple<time_t, time_t>(first_start + shift, first_end + shift));
         jobs[i] = std::make_shared<Job>(Job(
                 300,
                 storage_id + "_" + std::to_string(i),
@@ -115,13 +293,11 @@ Jobs generate_jobs(const std::vector<Point> &points, int start, int end, const s
 }
 
 std::tuple<int, Couriers, Storages, std::map<std::string, Matrix>>
-generate_rvrp(int jobs, int storages, int couriers) {
+generate_rvrp(int jobs, int storages, int couriers, std::optional<uint64_t> seed) {
     int size = jobs * storages + storages + couriers;
-    std::vector pts = generate_points(size);
-    std::vector distance = generate_distance(pts);
-    std::vector travel_time = generate_time(pts);
-    Matrix matrix("driver", distance, travel_time);
-    std::map<std::string, Matrix> ret_matrix = {{"driver", matrix}};
+    Random seeded(seed.value_or(0));
+    std::vector pts = generate_points(size, 55.65, 55.82, 37.45, 37.75, seed ? seeded : default_random());
+    std::map<std::string, Matrix> ret_matrix = {{"driver", generate_matrix("driver", pts)}};
     std::vector<Point> points(size);
     for (int i = 0; i < size; ++i) {
         points[i] = Point(i, pts[i]);
@@ -161,3 +337,138 @@ generate_rvrp(int jobs, int storages, int couriers) {
     printf("Generated\n\n");
     return {2, courier_list, storage_list, ret_matrix};
 }
+
+/**
+ * Нормальная величина по Боксу-Мюллеру: своя, чтобы набор не зависел от реализации std::normal_distribution
+ */
+float generate_gaussian(Random &random) {
+    float u = 1 - random.value();  // (0, 1], под логарифм
+    float v = random.value();
+    return std::sqrt(-2 * std::log(u)) * std::cos(float(2 * M_PI) * v);
+}
+
+/**
+ * Точки задач по семейству; долгота в кластере растянута на 1 / cos(широты), чтобы кластер был круглым
+ */
+std::vector<std::tuple<float, float>> generate_family_points(const InstanceConfig &config, int size, Random &random,
+                                                             float min_x, float max_x, float min_y, float max_y) {
+    std::vector ret = generate_points(size, min_x, max_x, min_y, max_y, random);
+    if (config.points == PointsFamily::Random) {
+        return ret;
+    }
+    std::vector centers = generate_points(std::max(config.clusters, 1), min_x, max_x, min_y, max_y, random);
+    float sigma_x = config.cluster_sigma;
+    float sigma_y = config.cluster_sigma / std::cos((min_x + max_x) / 2 * float(M_PI) / 180);
+    for (int i = config.points == PointsFamily::Mixed ? 1 : 0; i < size;
+         i += config.points == PointsFamily::Mixed ? 2 : 1) {
+        auto[x, y] = centers[random.number(uint32_t(centers.size()))];
+        ret[i] = {std::clamp(x + generate_gaussian(random) * sigma_x, min_x, max_x),
+                  std::clamp(y + generate_gaussian(random) * sigma_y, min_y, max_y)};
+    }
+    return ret;
+}
+
+std::tuple<int, Couriers, Storages, std::map<std::string, Matrix>>
+generate_instance(const InstanceConfig &config) {
+    if (config.jobs <= 0 || config.storages <= 0 || config.couriers <= 0 || config.profiles.empty()) {
+        throw std::invalid_argument("generate_instance: need jobs, storages, couriers and profiles");
+    }
+    constexpr float min_x = 55.65, max_x = 55.82, min_y = 37.45, max_y = 37.75;
+    const std::string extra_skills[] = {"fragile", "cold", "heavy"};
+    Random random(config.seed);
+
+    int locations = config.locations > 0 ? std::min(config.locations, config.jobs) : config.jobs;
+    int size = locations + config.storages + config.couriers;
+    std::vector pts = generate_family_points(config, locations, random, min_x, max_x, min_y, max_y);
+    std::vector rest = generate_points(config.storages + config.couriers, min_x, max_x, min_y, max_y, random);
+    pts.insert(pts.end(), rest.begin(), rest.end());
+
+    std::map<std::string, Matrix> ret_matrix;
+    for (const auto &profile : config.profiles) {
+        ret_matrix.emplace(profile.name, generate_matrix(profile.name, pts, config.layout, 0, profile.speed));
+    }
+    std::vector<Point> points(size);
+    for (int i = 0; i < size; ++i) {
+        points[i] = Point(i, pts[i]);
+    }
+
+    // единственный разбор строки, дальше окна - сдвиги от начала дня с шагом 15 минут
+    Window day("2020-10-01T10:00:00Z", "2020-10-01T20:00:00Z");
+    auto[day_start, day_end] = day.window;
+    constexpr time_t step = 900;
+
+    Storages storage_list(config.storages);
+    int per_storage = config.jobs / config.storages;
+    for (int s = 0; s < config.storages; ++s) {
+        std::string storage_id = "storage_" + std::to_string(s);
+        int count = s + 1 == config.storages ? config.jobs - per_storage * s : per_storage;
+        Jobs jobs(count);
+        for (int i = 0; i < count; ++i) {
+            int job = per_storage * s + i;
+            time_t length = day_end - day_start, start = day_start;
+            if (!config.window_free) {
+                length = config.tight_windows ? 3600 : 4 * 3600 + step * random.number(17);
+                start = day_start + step * random.number(uint32_t((day_end - day_start - length) / step + 1));
+            }
+            std::vector<int> value = {1, 2};
+            std::vector<std::string> skills = {"brains"};
+            int delay = 300;
+            if (config.heterogeneous) {
+                value = {1 + int(random.number(5)), 1 + int(random.number(10))};
+                delay = 180 + 60 * int(random.number(7));
+                for (const auto &skill : extra_skills) {
+                    if (random.number(8) == 0) {
+                        skills.push_back(skill);
+                    }
+                }
+            }
+            jobs[i] = std::make_shared<Job>(Job(
+                    delay,
+                    storage_id + "_" + std::to_string(i),
+                    std::move(value),
+                    std::move(skills),
+                    points[job % locations],
+                    {Window(std::tuple<time_t, time_t>(start, start + length))})
+            );
+        }
+        storage_list[s] = std::make_shared<Storage>(Storage(
+                300,
+                storage_id,
+                {"brains"},
+                points[locations + s],
+                day,
+                std::move(jobs))
+        );
+    }
+
+    Couriers courier_list(config.couriers);
+    for (int i = 0; i < config.couriers; ++i) {
+        Point &courier_loc = points[locations + config.storages + i];
+        Cost cost(10., 0.5, 1.2);
+        std::vector<int> value = {40, 80};
+        std::vector<std::string> skills = {"brains"};
+        if (config.heterogeneous) {  // три класса машин: каждый следующий вдвое больше и дороже
+            int type = int(random.number(3));
+            cost = Cost(10.f * float(1 << type), 0.5f + 0.25f * float(type), 1.2f + 0.3f * float(type));
+            value = {20 << type, 40 << type};
+            for (const auto &skill : extra_skills) {
+                if (random.boolean()) {
+                    skills.push_back(skill);
+                }
+            }
+        }
+        courier_list[i] = std::make_shared<Courier>(Courier(
+                "courier_" + std::to_string(i),
+                config.profiles[i % config.profiles.size()].name,
+                cost,
+                std::move(value),
+                std::move(skills),
+                0,
+                day,
+                courier_loc,
+                courier_loc,
+                storage_list)
+        );
+    }
+    return {2, courier_list, storage_list, ret_matrix};
+}
@@ -7,25 +7,35 @@
 #include <cmath>
 #include "base_model.h"
 
+/**
+ * Генератор generate_* по умолчанию: свой на поток, сид из std::random_device
+ */
+Random &default_random();
+
+/**
+ * Перезапуск default_random() текущего потока: дальнейшая генерация воспроизводима
+ */
+void generate_seed(uint64_t seed);
+
 /**
  * @return Рандомное значение от 0 до 1
  */
-float generate_value();
+float generate_value(Random &random = default_random());
 
 /**
  * @return random bool
  */
-bool generate_bool();
+bool generate_bool(Random &random = default_random());
 
 /**
  * @return random int [0, max)
  */
-int generate_number(int max);
+int generate_number(int max, Random &random = default_random());
 
 /**
  * @return Два рандомных значения от 0 до 1
  */
-std::tuple<float, float> generate_tuple();
+std::tuple<float, float> generate_tuple(Random &random = default_random());
 
 /**
  * Генерация рандомных точек в формате lat, lon в заданном квадрате
@@ -34,10 +44,12 @@ std::tuple<float, float> generate_tuple();
  * @param max_x
  * @param min_y
  * @param max_y
+ * @param random генератор
  * @return список из n таких точек
  */
 std::vector<std::tuple<float, float>>
-generate_points(int n, float min_x = 55.65, float max_x = 55.82, float min_y = 37.45, float max_y = 37.75);
+generate_points(int n, float min_x = 55.65, float max_x = 55.82, float min_y = 37.45, float max_y = 37.75,
+                Random &random = default_random());
 
 /**
  * Генерация матрицы расстояния для набора точек в формате lat, lon
@@ -53,6 +65,76 @@ std::vector<std::vector<int>> generate_distance(const std::vector<std::tuple<flo
  */
 std::vector<std::vector<time_t>> generate_time(const std::vector<std::tuple<float, float>> &points);
 
+/**
+ * Построчный haversine для Matrix(profile, size, row, ...): синусы и косинусы широт и долгот считаются
+ * один раз на точку, строка - без тригонометрии, кроме asin (на AVX2 - по 4 точки назначения за раз)
+ * Расстояние и время те же, что у generate_distance и generate_time (с точностью до метра на округлении)
+ * @param points список точек в (lat, lon)
+ * @param speed скорость в м/с
+ * @return строка матрицы, можно вызывать из нескольких потоков
+ */
+MatrixRow haversine_rows(const std::vector<std::tuple<float, float>> &points, double speed = 10);
+
+/**
+ * Матрицы расстояний и времени за один проход, строки параллельно и сразу в хранилище Matrix
+ * @param profile профиль матрицы
+ * @param points список точек в (lat, lon)
+ * @param layout способ хранения (матрица симметричная, так что подходит и Symmetric)
+ * @param threads кол-во потоков (0: по числу ядер)
+ * @param speed скорость в м/с (10 - как у generate_time)
+ * @return matrix
+ */
+Matrix generate_matrix(const std::string &profile,
+                       const std::vector<std::tuple<float, float>> &points,
+                       MatrixLayout layout = MatrixLayout::Flat,
+                       uint32_t threads = 0,
+                       double speed = 10);
+
+
+/**
+ * Параметры матрицы с пробками: срезы по discreteness секунд, время в срезе - время без пробок,
+ * умноженное на 1 + (f(t) - 1) * (w_src + w_dst) / 2, где f - утренний и вечерний пик (гауссовы по часу
+ * дня в середине среза), а w - загруженность точки из [1 - spread, 1 + spread]
+ */
+struct TrafficConfig {
+    uint32_t slices = 96;  // кол-во срезов (96 по 15 минут - сутки)
+    uint32_t discreteness = 900;  // длина среза в секундах
+    time_t start_time = 0;  // начало первого среза; час дня берется по UTC, как у Window
+    float morning_peak = 0.6;  // прибавка множителя в утренний пик
+    float morning_hour = 8.5;
+    float evening_peak = 0.8;  // прибавка множителя в вечерний пик
+    float evening_hour = 18;
+    float peak_width = 1.5;  // ширина пика в часах
+    float spread = 0.5;  // разброс загруженности точек
+    double speed = 10;  // скорость без пробок, м/с
+    MatrixLayout layout = MatrixLayout::Flat;
+    bool interpolation = false;
+    uint32_t threads = 0;  // 0: по числу ядер
+    uint64_t seed = 0;  // для загруженности точек
+};
+
+/**
+ * Строки матрицы с пробками для Matrix(profile, size, slices, row, ...): один haversine на строку,
+ * дальше срезы - множители к нему. Спад пика растянут так, что время FIFO:
+ * time[k] <= time[k + 1] + discreteness для любой пары точек (выехать позже не выгоднее), поэтому
+ * подходит и для интерполяции. Матрица симметричная, так что можно хранить в MatrixLayout::Symmetric
+ * @param points список точек в (lat, lon)
+ * @param config параметры пробок
+ * @return строка матрицы во всех срезах, можно вызывать из нескольких потоков
+ */
+MatrixRow traffic_rows(const std::vector<std::tuple<float, float>> &points, const TrafficConfig &config);
+
+/**
+ * Матрица с пробками: срезы строятся построчно сразу в хранилище config.layout
+ * @param profile профиль матрицы
+ * @param points список точек в (lat, lon)
+ * @param config параметры пробок и хранения
+ * @return matrix на config.slices срезов от config.start_time
+ */
+Matrix generate_traffic_matrix(const std::string &profile,
+                               const std::vector<std::tuple<float, float>> &points,
+                               const TrafficConfig &config);
+
 /**
  * Создание заказов из набора точек
  * @param points список точек
@@ -68,9 +150,56 @@ Jobs generate_jobs(const std::vector<Point> &points, int start, int end, const s
  * @param jobs кол-во задач на склад
  * @param storages кол-во складов
  * @param couriers кол-во курьеров
+ * @param seed сид точек (нет: default_random())
  * @return сгенерированные сущности
  */
 std::tuple<int, Couriers, Storages, std::map<std::string, Matrix>>
-generate_rvrp(int jobs, int storages, int couriers);
+generate_rvrp(int jobs, int storages, int couriers, std::optional<uint64_t> seed = std::nullopt);
+
+/**
+ * Расположение точек задач, как у семейств Соломона
+ */
+enum class PointsFamily : uint8_t {
+    Random,  // R: равномерно по квадрату
+    Clustered,  // C: нормально вокруг центров кластеров
+    Mixed,  // RC: половина равномерно, половина кластерами
+};
+
+/**
+ * Профиль синтетической задачи: имя матрицы и скорость
+ */
+struct InstanceProfile {
+    std::string name;
+    double speed = 10;  // м/с
+};
+
+/**
+ * Параметры синтетической задачи; все случайное берется из Random(seed), так что задача воспроизводима
+ */
+struct InstanceConfig {
+    int jobs = 1000;  // всего задач, поровну между складами (остаток - последнему)
+    int storages = 1;
+    int couriers = 10;
+    int locations = 0;  // различных точек задач (0: по точке на задачу), иначе задачи делят точки по кругу
+    PointsFamily points = PointsFamily::Random;
+    int clusters = 10;  // кол-во кластеров для Clustered и Mixed
+    float cluster_sigma = 0.005;  // стандартное отклонение кластера в градусах
+    bool tight_windows = false;  // окна по часу, иначе от 4 до 8 часов
+    bool window_free = false;  // окно задачи - весь день, как у складов и курьеров: окна ничего не ограничивают
+    bool heterogeneous = false;  // разные веса задач, вместимость, стоимость и умения курьеров
+    std::vector<InstanceProfile> profiles = {{"driver", 10}};  // курьеры по профилям по кругу
+    MatrixLayout layout = MatrixLayout::Flat;
+    uint64_t seed = 0;
+};
+
+/**
+ * Синтетическая задача по семействам (R/C/RC, узкие/широкие окна, разнородный парк, несколько профилей)
+ * Окна считаются от одного разобранного дня, без разбора строк на каждую задачу; на 100k задач
+ * матрица строится по locations точкам, а не по точке на задачу
+ * @param config параметры
+ * @return сгенерированные сущности, как у generate_rvrp
+ */
+std::tuple<int, Couriers, Storages, std::map<std::string, Matrix>>
+generate_instance(const InstanceConfig &config);
 
 #endif //MADRICH_SOLVER_GENERATORS_H
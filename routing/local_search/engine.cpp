@@ -2,10 +2,14 @@
 
 #include <utility>
 #include <algorithm>
+#include <local_search/problem.h>
+#include <local_search/segment.h>
 
 
 MadrichEngine::MadrichEngine(Storages storages, uint32_t size, bool ignore_priority)
-        : storages(std::move(storages)), routes(std::vector<Route>(size)), ignore_priority(ignore_priority) {}
+        : storages(std::move(storages)), routes(std::vector<Route>(size)), ignore_priority(ignore_priority) {
+    job_table = std::make_shared<JobTable>(this->storages);
+}
 
 MadrichEngine::MadrichEngine(
         uint16_t vec,
@@ -16,14 +20,25 @@ MadrichEngine::MadrichEngine(
         bool ignore_priority
 )
         : storages(storages), routes(std::vector<Route>(couriers.size())), ignore_priority(ignore_priority) {
+    job_table = std::make_shared<JobTable>(storages);
+    Matrices shared = share_matrices(matrices, couriers);
+    std::map symmetric = symmetric_matrices(shared);
+    RouteEvaluator evaluator = RvrpProblem::evaluator(vec, circle_track);  // один вариант оценки на весь тур
     std::size_t i = 0;
     for (const auto &courier : couriers) {
-        Matrix &matrix = matrices[courier->profile];
-        routes[i] = Route(vec, std::get<0>(courier->work_time.window), circle_track, courier, matrix);
+        job_table->add(courier);
+        routes[i] = Route(vec, std::get<0>(courier->work_time.window), circle_track, courier, shared[courier->profile],
+                          job_table);
+        routes[i].evaluator = evaluator;
+        routes[i].symmetric = symmetric[courier->profile];
         ++i;
     }
 }
 
+void MadrichEngine::seed(uint64_t seed) {
+    random.seed(seed);
+}
+
 State MadrichEngine::get_state() const {
     State state;
     for (const auto &route : routes) {
@@ -60,6 +75,77 @@ void MadrichEngine::print() const {
     }
 }
 
+[[maybe_unused]] void MadrichEngine::memory_report() const {
+    std::set<const Matrix *> matrices;
+    std::set<const CostMatrix *> costs;
+    std::size_t matrix_bytes = 0;
+    std::size_t cost_bytes = 0;
+    std::size_t route_bytes = 0;
+    for (const auto &route : routes) {
+        if (route.matrix && matrices.insert(route.matrix.get()).second) {
+            matrix_bytes += route.matrix->memory_usage();
+        }
+        if (route.costs && costs.insert(route.costs.get()).second) {
+            cost_bytes += route.costs->memory_usage();
+        }
+        route_bytes += route.memory_usage();
+    }
+    printf("Memory; routes: %zu (%zu bytes), matrices: %zu (%zu bytes), costs: %zu (%zu bytes)\n",
+           routes.size(), route_bytes, matrices.size(), matrix_bytes, costs.size(), cost_bytes);
+}
+
+[[maybe_unused]] void MadrichEngine::cache_costs() {
+    std::vector<ptrCostMatrix> shared;
+    for (auto &route : routes) {
+        if (!route.matrix || route.matrix->interpolated()) {
+            continue;
+        }
+        auto it = std::find_if(shared.begin(), shared.end(), [&route](const ptrCostMatrix &costs) {
+            return costs->match(route.matrix, route.courier->cost);
+        });
+        if (it != shared.end()) {
+            route.costs = *it;
+            continue;
+        }
+        if (!route.costs || !route.costs->match(route.matrix, route.courier->cost)) {  // уже построенную не трогаем
+            route.costs = std::make_shared<const CostMatrix>(route.matrix, route.courier->cost);
+        }
+        shared.push_back(route.costs);
+    }
+}
+
+[[maybe_unused]] void MadrichEngine::cache_states(std::size_t capacity) {
+    ptrEvaluationCache cache = capacity ? std::make_shared<EvaluationCache>(capacity) : nullptr;
+    for (auto &route : routes) {
+        route.cache = cache;
+    }
+}
+
+[[maybe_unused]] void MadrichEngine::cache_report() const {
+    if (routes.empty() || !routes[0].cache) {
+        printf("Evaluation cache: off\n");
+        return;
+    }
+    const EvaluationCache &cache = *routes[0].cache;
+    printf("Evaluation cache; hits: %ju, misses: %ju, hit rate: %.1f%%, evictions: %ju, routes: %zu/%zu (%zu bytes)\n",
+           uintmax_t(cache.hits), uintmax_t(cache.misses), 100 * cache.hit_rate(), uintmax_t(cache.evictions),
+           cache.size(), cache.capacity(), cache.memory_usage());
+}
+
+[[maybe_unused]] void MadrichEngine::screen_report(bool reset) {
+    const char *names[SCREEN_OPERATORS] = {"two_opt", "three_opt", "inter_swap", "inter_cross"};
+    for (std::size_t op = 0; op < SCREEN_OPERATORS; ++op) {
+        ScreenCounters &counters = screen_counters(ScreenOperator(op));
+        printf("Screen %s; moves: %ju, by arcs: %ju, by limits: %ju, evaluated: %ju (%.1f%%)\n", names[op],
+               uintmax_t(counters.moves), uintmax_t(counters.arcs), uintmax_t(counters.limits),
+               uintmax_t(counters.evaluated),
+               counters.moves == 0 ? 0. : 100. * double(counters.evaluated) / double(counters.moves));
+        if (reset) {
+            counters = ScreenCounters();
+        }
+    }
+}
+
 [[maybe_unused]] void MadrichEngine::add_job(ptrJob &job, ptrStorage &storage) {
     set_zeros();
     auto it_storage = std::find(storages.begin(), storages.end(), storage);
@@ -67,6 +153,7 @@ void MadrichEngine::print() const {
         return;
     } else {
         auto index = std::distance(storages.begin(), it_storage);
+        job_table->add(job, storage);
         storages[index]->unassigned_jobs.emplace_back(job);
     }
 }
@@ -94,9 +181,13 @@ void MadrichEngine::print() const {
         storage->unassigned_jobs.erase(storage->unassigned_jobs.begin(), here1);
         return;
     }
+    if (!job_table->contains(job)) {
+        return;
+    }
+    uint32_t id = job_table->index(job);
     for (auto &route : routes) {
         for (auto &track : route.tracks) {
-            auto here2 = std::find(track.jobs.begin(), track.jobs.end(), job);
+            auto here2 = std::find(track.jobs.begin(), track.jobs.end(), id);
             if (here2 != track.jobs.end()) {
                 track.jobs.erase(track.jobs.begin(), here2);
                 return;
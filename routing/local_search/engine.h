@@ -10,6 +10,9 @@
 using namespace std::chrono;
 typedef std::optional<time_point<system_clock>> optional_end;
 
+class RouteSegments;
+typedef std::vector<std::optional<RouteSegments>> InsertSegments;  // куски маршрутов для вставок, по номеру маршрута
+
 /**
  * Оптимизация
  * Оптимизация на данный момент происходит в три этапа: ruin, recreate, local search.
@@ -38,6 +41,7 @@ class MadrichEngine {
 public:
     bool ignore_priority = true;  // игнорируем ли приоритеты задачи
     Storages storages;  // все склады в задаче
+    shared_ptr<JobTable> job_table = std::make_shared<JobTable>();  // все задачи тура, ее разделяют маршруты
     std::vector<Route> routes;  // все маршруты для курьеров
 
     explicit MadrichEngine() = default;
@@ -64,15 +68,21 @@ public:
      * @param phases сколько фаз улучшения доступно (0: не прерываться)
      * @param post_three_opt использовать для пост-оптимизации 3-opt
      * @param post_cross использовать для пост-оптимизации Cross-exchange
+     * @param neighbors гранулярные соседи (см. GranularNeighbors): операторы и вставка рассматривают только ходы
+     * с дугой между одним из neighbors ближайших соседей (0: без ограничений)
+     * @param neighbor_windows учитывать временные окна при выборе соседей
      */
     void improve(uint32_t work_time = 0,
                  uint32_t max_fails = 5,
                  uint32_t phases = 0,
                  bool post_three_opt = false,
-                 bool post_cross = false);
+                 bool post_cross = false,
+                 uint32_t neighbors = 0,
+                 bool neighbor_windows = false);
 
     /**
      * Одну задачу; Если склада нет в списке, то задача не будет добавлена
+     * Задача получает номер в таблице задач тура
      */
     [[maybe_unused]] void add_job(ptrJob &job, ptrStorage &storage);
 
@@ -110,7 +120,48 @@ public:
 
     [[maybe_unused]] void draw() const;
 
+    /**
+     * Память тура: уникальные матрицы, таблицы стоимостей и маршруты
+     */
+    [[maybe_unused]] void memory_report() const;
+
+    /**
+     * Таблицы стоимостей перегонов (см. CostMatrix): по одной на пару (матрица, тариф),
+     * строятся только для встреченных у курьеров пар и только при вызове; уже подходящие не перестраиваются
+     * Память: 4 байта на ячейку каждого среза для каждой пары; матрицы с интерполяцией пропускаются
+     */
+    [[maybe_unused]] void cache_costs();
+
+    /**
+     * Память оценок маршрутов (см. EvaluationCache), одна на тур: get_state уже встречавшегося маршрута -
+     * хеш по номерам задач вместо прохода по матрице, результаты те же. Вызывать заново (таблица строится
+     * с нуля), если после этого менялись задачи, склады или окна задач (курьеры и матрицы входят в отпечаток)
+     * Память: capacity ячеек по 88 байт
+     * @param capacity сколько маршрутов помнить (0: выключить)
+     */
+    [[maybe_unused]] void cache_states(std::size_t capacity = 1 << 16);
+
+    /**
+     * Попадания в память оценок (см. cache_states)
+     */
+    [[maybe_unused]] void cache_report() const;
+
+    /**
+     * Сколько ходов two_opt, three_opt, inter_swap и inter_cross отсеяно до get_state по ступеням
+     * (см. RouteSegments::screen): счетчики потока с начала работы или с прошлого сброса
+     * @param reset обнулить счетчики после печати
+     */
+    [[maybe_unused]] static void screen_report(bool reset = false);
+
+    /**
+     * Сид генератора движка (ruin, порядок intra/inter в improve): с одинаковым сидом и фазами
+     * improve воспроизводим; по умолчанию сид из std::random_device
+     */
+    void seed(uint64_t seed);
+
 private:
+    Random random;  // свой генератор движка, без random_device на каждую выборку
+
     //// Block section
 
     /**
@@ -167,6 +218,13 @@ private:
 
     //// Improve section
 
+    /**
+     * Строит гранулярных соседей по всем задачам, один индекс на матрицу, и раздает маршрутам
+     * @param neighbors сколько соседей у задачи (0: убрать ограничение)
+     * @param time_windows учитывать временные окна
+     */
+    void set_neighbors(uint32_t neighbors, bool time_windows);
+
     /**
      * Последовательный запуск local_search / ruin / recreate
      * Перезапускаемся пока не кончатся фазы, время или 5 раз не сможем улучшить результат
@@ -235,6 +293,8 @@ private:
 
     /**
      * Вставка неназначенных еще задач
+     * Куски маршрутов (см. RouteSegments) строятся при первой вставке в маршрут и живут до конца вставок:
+     * пересчитывается только маршрут, в который вставили
      * @param priority игнорировать ли приоритеты
      * @return получилось ли вставить
      */
@@ -243,35 +303,42 @@ private:
     /**
      * Ищем лучшую вставку с учетом текущего приоритета
      * @param current_priority
+     * @param segments куски маршрутов, у выбранного для вставки маршрута сбрасываются
      * @return получилось вставить или нет
      */
-    bool insert_best(uint32_t current_priority);
+    bool insert_best(uint32_t current_priority, InsertSegments &segments);
 
     /**
      * Выбираем лучшую вставку из вставки задачи в трек и трек в маршрут
      * @param best_state текущее лучшее delta state
      * @param job задача
      * @param storage откуда заказ
+     * @param segments куски маршрутов
      * @return каким методом, delta state + куда
      */
     std::optional<std::tuple<char, std::tuple<State, int, int, int>>>
-    choose_best(const std::optional<State> &best_state, const ptrJob &job, const ptrStorage &storage);
+    choose_best(const std::optional<State> &best_state, const ptrJob &job, const ptrStorage &storage,
+                InsertSegments &segments);
 
     /**
      * Вставить в текущие подмаршруты
      * @param storage откуда заказ
      * @param job сам заказ
+     * @param cache куски маршрутов: место проверяется за O(1), get_state - только без кусков
      * @return delta state, куда
      */
-    std::optional<std::tuple<State, int, int, int>> insert_job(const ptrJob &job, const ptrStorage &storage);
+    std::optional<std::tuple<State, int, int, int>> insert_job(uint32_t job, const ptrStorage &storage,
+                                                               InsertSegments &cache);
 
     /**
      * Создает для вставки подмаршрут с новой точкой
      * @param storage откуда заказ
      * @param job сам заказ
+     * @param cache куски маршрутов
      * @return delta state, куда
      */
-    std::optional<std::tuple<State, int, int, int>> insert_track(const ptrJob &job, const ptrStorage &storage);
+    std::optional<std::tuple<State, int, int, int>> insert_track(uint32_t job, const ptrStorage &storage,
+                                                                 InsertSegments &cache);
 
     /**
      * Максимальный приоритет неназначенных задач
@@ -2,7 +2,6 @@
 
 #include <local_search/operators/inter_operators.h>
 #include <local_search/operators/intra_operators.h>
-#include <generators.h>
 
 
 void MadrichEngine::improve(
@@ -10,7 +9,9 @@ void MadrichEngine::improve(
         uint32_t max_fails,
         uint32_t phases,
         bool post_three_opt,
-        bool post_cross
+        bool post_cross,
+        uint32_t neighbors,
+        bool neighbor_windows
 ) {
     printf("Improve started\n");
     auto start_t = system_clock::now();
@@ -20,13 +21,36 @@ void MadrichEngine::improve(
     }
     check_block();
     draw();
+    set_neighbors(neighbors, neighbor_windows);
 
     continuous_improve(max_fails, phases, post_three_opt, post_cross, stop_moment);
 
+    set_neighbors(0, false);  // ограничение только на время улучшения
     draw();
     printf("\nDone, %jd seconds\n\n", duration_cast<seconds>(system_clock::now() - start_t).count());
 }
 
+void MadrichEngine::set_neighbors(uint32_t neighbors, bool time_windows) {
+    if (neighbors == 0) {
+        for (auto &route : routes) {
+            route.neighbors = nullptr;
+        }
+        return;
+    }
+
+    std::map<const Matrix *, ptrNeighbors> shared;
+    for (auto &route : routes) {
+        if (!route.matrix) {
+            continue;
+        }
+        ptrNeighbors &index = shared[route.matrix.get()];
+        if (!index) {
+            index = std::make_shared<const GranularNeighbors>(*route.matrix, *job_table, neighbors, time_windows);
+        }
+        route.neighbors = index;
+    }
+}
+
 void MadrichEngine::continuous_improve(
         uint32_t max_fails,
         uint32_t phases,
@@ -85,7 +109,7 @@ void MadrichEngine::improve_tour(uint32_t phases, bool post_three_opt, bool post
         }
 
         changed = false;
-        bool vr = generate_bool();
+        bool vr = random.boolean();
 
         // inter и intra могут запускаться в разном порядке,
         // что в теории может приводить к разным локальным минимумам
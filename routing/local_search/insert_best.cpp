@@ -2,6 +2,7 @@
 
 #include <local_search/operators/route_utils.h>
 #include <local_search/problem.h>
+#include <local_search/segment.h>
 
 using std::optional;
 typedef std::tuple<State, int, int, int> answer_t;
@@ -22,7 +23,7 @@ uint32_t MadrichEngine::max_priority() const {
     return max;
 }
 
-bool MadrichEngine::insert_best(uint32_t current_priority) {
+bool MadrichEngine::insert_best(uint32_t current_priority, InsertSegments &segments) {
     int storage_id, job_id;
     char operation;
     answer_t best_answer;
@@ -40,7 +41,7 @@ bool MadrichEngine::insert_best(uint32_t current_priority) {
                 continue;
             }
 
-            std::optional answer = choose_best(best_state, job, storage);
+            std::optional answer = choose_best(best_state, job, storage, segments);
             if (!answer) {
                 continue;
             }
@@ -58,13 +59,13 @@ bool MadrichEngine::insert_best(uint32_t current_priority) {
         const auto&[_, a, b, c] = best_answer;
         Route &route = routes[a];
         ptrStorage &storage = storages[storage_id];
-        ptrJob &job = storage->unassigned_jobs[job_id];
+        uint32_t job = job_table->index(storage->unassigned_jobs[job_id]);
         mark_route(true, route);
 
         if (operation == 's') {  // или тупо вставка трека в маршрут
             route.tracks.insert(route.tracks.begin() + b, Track(job, storage));
         } else if (operation == 'f') {  // или вставляем задачу в правильное место в существующем треке
-            Jobs jobs = route.tracks[b].jobs;
+            JobIds jobs = route.tracks[b].jobs;
             std::vector new_jobs = insert(c, job, jobs);
             route.tracks[b].jobs = new_jobs;
         } else {
@@ -72,7 +73,8 @@ bool MadrichEngine::insert_best(uint32_t current_priority) {
             return false;
         }
 
-        route.state = RvrpProblem::get_state(route).value();
+        route.state = RvrpProblem::get_state(route).value();  // полная оценка - только у выбранной вставки
+        segments[a].reset();
         storage->unassigned_jobs.erase(storage->unassigned_jobs.begin() + job_id);
         printf("Inserted\n");
     }
@@ -86,9 +88,10 @@ bool MadrichEngine::unassigned_insert() {
     bool changed = true;
     uint32_t max = ignore_priority ? 0 : max_priority();
     uint32_t curr = 0;
+    InsertSegments segments(routes.size());  // маршруты могли поменяться с прошлых вставок: строим заново
 
     while (changed || (!ignore_priority && curr <= max)) {
-        changed = insert_best(curr);
+        changed = insert_best(curr, segments);
         if (!changed && (!ignore_priority && curr <= max)) {
             ++curr;
         }
@@ -99,12 +102,14 @@ bool MadrichEngine::unassigned_insert() {
 }
 
 optional<std::tuple<char, answer_t>>
-MadrichEngine::choose_best(const optional<State> &best_state, const ptrJob &job, const ptrStorage &storage) {
+MadrichEngine::choose_best(const optional<State> &best_state, const ptrJob &job, const ptrStorage &storage,
+                           InsertSegments &segments) {
     char operation;
     answer_t value;
 
-    std::optional first = insert_job(job, storage);  // вставка в трек
-    std::optional second = insert_track(job, storage);  // вставка трека
+    uint32_t id = job_table->index(job);
+    std::optional first = insert_job(id, storage, segments);  // вставка в трек
+    std::optional second = insert_track(id, storage, segments);  // вставка трека
 
     if (!first && !second) {
         return std::nullopt;
@@ -130,50 +135,82 @@ MadrichEngine::choose_best(const optional<State> &best_state, const ptrJob &job,
     return std::nullopt;
 }
 
-bool check_value(const ptrJob &job, const Track &track, const Route &route) {
-    State track_state = RvrpProblem::get_state_track(track, route);
-    bool flag = true;
+bool check_value(uint32_t job, const Track &track, const Route &route) {
+    const JobTable &table = *route.job_table;
+    Load load = table.demand[job];  // только груз подмаршрута, время и стоимость тут не нужны
+    for (uint32_t track_job : track.jobs) {
+        for (uint32_t k = 0; k < route.vec; ++k) {
+            load[k] += table.demand[track_job][k];
+        }
+    }
     for (uint32_t k = 0; k < route.vec; ++k) {  // проверка на переполнение
-        if (track_state.value.value()[k] + job->value[k] > route.courier->value[k]) {
-            flag = false;
-            break;
+        if (load[k] > route.courier->value[k]) {
+            return false;
         }
     }
-    return flag;
+    return true;
 }
 
-optional<answer_t> MadrichEngine::insert_job(const ptrJob &job, const ptrStorage &storage) {
+/**
+ * Куски маршрута для вставок: строятся один раз, пока маршрут не поменяется (nullptr - склейкой нельзя)
+ */
+RouteSegments *insert_segments(InsertSegments &segments, const Route &route, int i) {
+    if (!RouteSegments::usable(route)) {
+        return nullptr;
+    }
+    if (!segments[i]) {
+        segments[i].emplace(route);
+        segments[i]->select_all();
+    }
+    return &segments[i].value();
+}
+
+optional<answer_t> MadrichEngine::insert_job(uint32_t job, const ptrStorage &storage, InsertSegments &cache) {
     int a, b, c;
     a = b = c = -1;
     State best_state;
 
     for (int i = 0; i < routes.size(); ++i) {
         Route &route = routes[i];
-        if (!check_route(route) ||
-            !RvrpProblem::validate_storage(storage, route.courier) ||
-            !RvrpProblem::validate_skills(job, route.courier) ||
-            !RvrpProblem::validate_skills(storage, route.courier)) {
-            continue;
+        if (!check_route(route) || !job_table->serves(job_table->index(route.courier), job)) {
+            continue;  // склад недоступен или не хватает умений
         }
+        RouteSegments *segments = insert_segments(cache, route, i);  // вставка склейкой, если маршрут позволяет
+        Segment piece = segments ? segments->job(job) : Segment();
 
         for (int j = 0; j < route.tracks.size(); ++j) {
             Track &track = route.tracks[j];
-            if (track.storage != storage || !check_value(job, track, route)) {
+            if (track.storage != storage) {
+                continue;
+            }
+            if (segments) {
+                segments->pick(j);
+                if (!segments->fits(piece)) {
+                    continue;
+                }
+            } else if (!check_value(job, track, route)) {
                 continue;
             }
 
-            Jobs tmp = track.jobs;
+            JobIds tmp = track.jobs;
             for (int k = 0; k < track.jobs.size(); ++k) {
-                std::vector new_jobs = insert(k, job, track.jobs);
-                track.jobs = new_jobs;
-                std::optional state = RvrpProblem::get_state(route);
+                if (!granular(route, job_at(tmp, k - 1), job) && !granular(route, job, job_at(tmp, k))) {
+                    continue;  // ни одной дуги между соседями
+                }
+                std::optional<State> state;
+                if (segments) {
+                    state = segments->replaced(k, k, piece);
+                } else {
+                    track.jobs = insert(k, job, tmp);
+                    state = RvrpProblem::get_state(route);
+                    track.jobs = tmp;
+                }
                 if (state && (a == -1 || state.value() - route.state < best_state)) {
                     best_state = state.value() - route.state;  // все так же ищем лучшее
                     a = i;
                     b = j;
                     c = k;
                 }
-                track.jobs = tmp;
             }
         }
     }
@@ -184,18 +221,15 @@ optional<answer_t> MadrichEngine::insert_job(const ptrJob &job, const ptrStorage
     return std::make_tuple(best_state, a, b, c);
 }
 
-optional<answer_t> MadrichEngine::insert_track(const ptrJob &job, const ptrStorage &storage) {
+optional<answer_t> MadrichEngine::insert_track(uint32_t job, const ptrStorage &storage, InsertSegments &cache) {
     int a, b;
     a = b = -1;
     State best_state;
 
     for (int i = 0; i < routes.size(); ++i) {
         Route &route = routes[i];
-        if (!check_route(route) ||
-            !RvrpProblem::validate_storage(storage, route.courier) ||
-            !RvrpProblem::validate_skills(job, route.courier) ||
-            !RvrpProblem::validate_skills(storage, route.courier)) {
-            continue;
+        if (!check_route(route) || !job_table->serves(job_table->index(route.courier), job)) {
+            continue;  // склад недоступен или не хватает умений
         }
 
         Track track(job, storage);
@@ -203,18 +237,34 @@ optional<answer_t> MadrichEngine::insert_track(const ptrJob &job, const ptrStora
         if (!RvrpProblem::validate_courier(route.state + min_dt, route)) {
             continue;
         }
+        RouteSegments *segments = insert_segments(cache, route, i);  // вставка склейкой, если маршрут позволяет
+        Segment piece = segments ? segments->track(track) : Segment();
 
         if (route.tracks.empty()) {  // если в маршруте вообще ничего еще нет
-            route.tracks.push_back(track);
-            std::optional state = RvrpProblem::get_state(route);
+            std::optional<State> state;
+            if (segments) {
+                state = segments->inserted(0, piece);
+            } else {
+                route.tracks.push_back(track);
+                state = RvrpProblem::get_state(route);
+                route.tracks.pop_back();
+            }
             if (state && (a == -1 || state.value() - route.state < best_state)) {
                 best_state = state.value() - route.state;
                 a = i;
                 b = 0;
             }
-            route.tracks.pop_back();
         } else {  // если есть, перебираем места вставки
             for (int j = 0; j < route.tracks.size(); ++j) {
+                if (segments) {
+                    std::optional state = segments->inserted(j, piece);
+                    if (state && (a == -1 || state.value() - route.state < best_state)) {
+                        best_state = state.value() - route.state;
+                        a = i;
+                        b = j;
+                    }
+                    continue;
+                }
                 route.tracks.insert(route.tracks.begin() + j, track);
                 std::optional state = RvrpProblem::get_state(route);
                 if (state && (a == -1 || state.value() - route.state < best_state)) {
@@ -1,6 +1,78 @@
 #include "inter_operators.h"
 
 
+/**
+ * Номер курьера маршрута в таблице задач: задачу, которую он взять не может (см. JobTable::serves),
+ * ход не оценивает
+ */
+uint32_t courier_of(const Route &route) {
+    return route.job_table->index(route.courier);
+}
+
+/**
+ * Префиксные суммы задач, которые курьер маршрута взять не может: кусок [a, b] переносим, если foreign[b + 1] == foreign[a]
+ */
+std::vector<uint32_t> foreign_jobs(const JobIds &jobs, const Route &route) {
+    const JobTable &table = *route.job_table;
+    uint32_t courier = courier_of(route);
+    std::vector<uint32_t> foreign(jobs.size() + 1, 0);
+    for (std::size_t i = 0; i < jobs.size(); ++i) {
+        foreign[i + 1] = foreign[i] + !table.serves(courier, jobs[i]);
+    }
+    return foreign;
+}
+
+/**
+ * Ходы оцениваются склейкой (см. RouteSegments), если оба маршрута это позволяют и это разные маршруты:
+ * в одном маршруте меняются оба подмаршрута, а середину между ними за O(1) не склеить
+ */
+bool segmentable(const Route &route1, const Route &route2) {
+    return &route1 != &route2 && RouteSegments::usable(route1) && RouteSegments::usable(route2);
+}
+
+/**
+ * Иначе склейка годится для отсева ходов перед get_state (см. RouteSegments::bounded), тоже в разных маршрутах
+ */
+bool boundable(const Route &route1, const Route &route2) {
+    return &route1 != &route2 && RouteSegments::bounded(route1) && RouteSegments::bounded(route2);
+}
+
+/**
+ * Создает ли обмен jobs1[it1] <-> jobs2[it2] дугу между соседями
+ */
+bool swap_granular(const JobIds &jobs1, const Route &route1, const JobIds &jobs2, const Route &route2,
+                   uint32_t it1, uint32_t it2) {
+    uint32_t job1 = jobs1[it1];
+    uint32_t job2 = jobs2[it2];
+    return granular(route2, job_at(jobs2, int64_t(it2) - 1), job1) ||
+           granular(route2, job1, job_at(jobs2, it2 + 1)) ||
+           granular(route1, job_at(jobs1, int64_t(it1) - 1), job2) ||
+           granular(route1, job2, job_at(jobs1, it1 + 1));
+}
+
+/**
+ * Создает ли перенос jobs2[it2] на место it1 в jobs1 дугу между соседями
+ */
+bool replace_granular(const JobIds &jobs1, const Route &route1, const JobIds &jobs2, const Route &route2,
+                      uint32_t it1, uint32_t it2) {
+    uint32_t job = jobs2[it2];
+    return granular(route1, job_at(jobs1, int64_t(it1) - 1), job) ||
+           granular(route1, job, job_at(jobs1, it1)) ||
+           granular(route2, job_at(jobs2, int64_t(it2) - 1), job_at(jobs2, it2 + 1));
+}
+
+/**
+ * Создает ли обмен кусков jobs1[it1, it2] <-> jobs2[it3, it4] дугу между соседями
+ */
+bool cross_granular(const JobIds &jobs1, const Route &route1, const JobIds &jobs2, const Route &route2,
+                    uint32_t it1, uint32_t it2, uint32_t it3, uint32_t it4) {
+    return granular(route1, job_at(jobs1, int64_t(it1) - 1), jobs2[it3]) ||
+           granular(route1, jobs2[it4], job_at(jobs1, it2 + 1)) ||
+           granular(route2, job_at(jobs2, int64_t(it3) - 1), jobs1[it1]) ||
+           granular(route2, jobs1[it2], job_at(jobs2, it4 + 1));
+}
+
+
 bool inter_swap(Track &track1, Route &route1, Track &track2, Route &route2, optional_end end) {
     if (track1.storage != track2.storage) {
         return false;
@@ -13,43 +85,74 @@ bool inter_swap(Track &track1, Route &route1, Track &track2, Route &route2, opti
     State state = route1.state + route2.state;
     bool changed = true;
     bool result = false;
+    bool glued = segmentable(route1, route2);  // иначе склейка - только отсев
+    std::optional<RouteSegments> segments1, segments2;
+    if (glued || boundable(route1, route2)) {
+        segments1.emplace(route1, track1);
+        segments2.emplace(route2, track2);
+    }
+    ScreenCounters &counters = screen_counters(ScreenOperator::Swap);
+    const JobTable &table = *route1.job_table;
+    uint32_t courier1 = courier_of(route1), courier2 = courier_of(route2);
     printf("\nSwap started, tt: %jd, cost: %f\n", state.travel_time, state.cost);
 
     while (changed) {
         changed = false;
         State best_state1, best_state2;
         State best_state = state;
-        uint32_t a, b;
+        uint32_t a = 0, b = 0;
 
         for (uint32_t it1 = 0; it1 < size1; ++it1) {
             for (uint32_t it2 = 0; it2 < size2; ++it2) {
-                std::swap(track1.jobs[it1], track2.jobs[it2]);  // TODO: check opt
-                std::optional new_state1 = RvrpProblem::get_state(route1);
-                std::optional new_state2 = RvrpProblem::get_state(route2);
-                if ((!new_state1) || (!new_state2)) {
+                if (!table.serves(courier2, track1.jobs[it1]) || !table.serves(courier1, track2.jobs[it2]) ||
+                    !swap_granular(track1.jobs, route1, track2.jobs, route2, it1, it2)) {
+                    continue;
+                }
+                std::optional<State> new_state1, new_state2;
+                if (glued) {
+                    new_state1 = segments1->replaced(it1, it1 + 1, segments1->job(track2.jobs[it2]));
+                    new_state2 = segments2->replaced(it2, it2 + 1, segments2->job(track1.jobs[it1]));
+                } else if (!segments1 || RouteSegments::screen(
+                        counters, route1, segments1->bound(it1, it1 + 1, segments1->job(track2.jobs[it2])),
+                        route2, segments2->bound(it2, it2 + 1, segments2->job(track1.jobs[it1])), best_state)) {
+                    std::swap(track1.jobs[it1], track2.jobs[it2]);
+                    new_state1 = RvrpProblem::get_state(route1);
+                    new_state2 = RvrpProblem::get_state(route2);
                     std::swap(track1.jobs[it1], track2.jobs[it2]);
+                }
+                if ((!new_state1) || (!new_state2)) {
                     continue;
                 }
                 State new_state = new_state1.value() + new_state2.value();
                 if (new_state < best_state) {
-                    result = changed = true;
+                    changed = true;
                     best_state = new_state;
                     best_state1 = new_state1.value();
                     best_state2 = new_state2.value();
                     a = it1;
                     b = it2;
                 }
-                std::swap(track1.jobs[it1], track2.jobs[it2]);
             }
         }
 
         if (changed) {
-            state = best_state;
+            std::swap(track1.jobs[a], track2.jobs[b]);
+            if (glued && !RouteSegments::confirm(route1, route2, state, best_state1, best_state2)) {
+                std::swap(track1.jobs[a], track2.jobs[b]);
+                changed = false;
+            }
+        }
+        if (changed) {
+            result = true;
+            state = best_state1 + best_state2;
             state1 = best_state1;
             state2 = best_state2;
-            std::swap(track1.jobs[a], track2.jobs[b]);
+            if (segments1) {
+                segments1->select(track1);
+                segments2->select(track2);
+            }
             if (end && end.value() < system_clock::now()) { changed = false; }
-            printf("Updated, tt: %jd, cost: %f\n", best_state.travel_time, best_state.cost);
+            printf("Updated, tt: %jd, cost: %f\n", state.travel_time, state.cost);
         }
     }
     printf("Ended, tt: %jd, cost %f\n", state.travel_time, state.cost);
@@ -61,7 +164,7 @@ bool inter_swap(Track &track1, Route &route1, Track &track2, Route &route2, opti
 }
 
 std::optional<std::tuple<State, State>>
-get_states(std::tuple<Jobs, Jobs> &new_jobs, Track &track1, Route &route1, Track &track2, Route &route2) {
+get_states(std::tuple<JobIds, JobIds> &new_jobs, Track &track1, Route &route1, Track &track2, Route &route2) {
     auto&[new_jobs1, new_jobs2] = new_jobs;
     std::vector old_jobs1 = track1.jobs;
     std::vector old_jobs2 = track2.jobs;
@@ -87,19 +190,39 @@ bool uns_inter_replace(Track &track1, Route &route1, Track &track2, Route &route
     State state = route1.state + route2.state;
     bool changed = true;
     bool result = false;
+    std::optional<RouteSegments> segments1, segments2;
+    if (segmentable(route1, route2)) {
+        segments1.emplace(route1, track1);
+        segments2.emplace(route2, track2);
+    }
+    const JobTable &table = *route1.job_table;
+    uint32_t courier1 = courier_of(route1);
 
     while (changed) {
         changed = false;
         State best_state1, best_state2;
-        Jobs best_jobs1, best_jobs2;
         State best_state = state;
+        uint32_t a = 0, b = 0;
         uint32_t size1 = track1.jobs.size();
         uint32_t size2 = track2.jobs.size();
 
         for (uint32_t it1 = 0; it1 < size1; ++it1) {
             for (uint32_t it2 = 0; it2 < size2; ++it2) {
-                std::tuple new_jobs = replace_point(track1.jobs, track2.jobs, it1, it2);  // TODO: remove bad opt
-                std::optional answer = get_states(new_jobs, track1, route1, track2, route2);
+                if (!table.serves(courier1, track2.jobs[it2]) ||
+                    !replace_granular(track1.jobs, route1, track2.jobs, route2, it1, it2)) {
+                    continue;
+                }
+                std::optional<std::tuple<State, State>> answer;
+                if (segments1) {
+                    std::optional new_state1 = segments1->replaced(it1, it1, segments1->job(track2.jobs[it2]));
+                    std::optional new_state2 = segments2->replaced(it2, it2 + 1, Segment());
+                    if (new_state1 && new_state2) {
+                        answer = std::make_tuple(new_state1.value(), new_state2.value());
+                    }
+                } else {
+                    std::tuple new_jobs = replace_point(track1.jobs, track2.jobs, it1, it2);  // TODO: remove bad opt
+                    answer = get_states(new_jobs, track1, route1, track2, route2);
+                }
                 if (!answer) {  // а еще трек вообще может быть убран из маршрута
                     continue;
                 }
@@ -107,24 +230,36 @@ bool uns_inter_replace(Track &track1, Route &route1, Track &track2, Route &route
                 auto&[new_state1, new_state2] = answer.value();
                 State new_state = new_state1 + new_state2;
                 if (new_state < best_state) {
-                    result = changed = true;
+                    changed = true;
                     best_state = new_state;
                     best_state1 = new_state1;
                     best_state2 = new_state2;
-                    auto&[new_jobs1, new_jobs2] = new_jobs;
-                    best_jobs1 = new_jobs1;
-                    best_jobs2 = new_jobs2;
+                    a = it1;
+                    b = it2;
                 }
             }
         }
         if (changed) {
-            state = best_state;
+            JobIds jobs1 = track1.jobs;
+            JobIds jobs2 = track2.jobs;
+            std::tie(track1.jobs, track2.jobs) = replace_point(jobs1, jobs2, a, b);
+            if (segments1 && !RouteSegments::confirm(route1, route2, state, best_state1, best_state2)) {
+                track1.jobs = jobs1;
+                track2.jobs = jobs2;
+                changed = false;
+            }
+        }
+        if (changed) {
+            result = true;
+            state = best_state1 + best_state2;
             state1 = best_state1;
             state2 = best_state2;
-            track1.jobs = best_jobs1;
-            track2.jobs = best_jobs2;
+            if (segments1) {
+                segments1->select(track1);
+                segments2->select(track2);
+            }
             if (end && end.value() < system_clock::now()) { changed = false; }
-            printf("Updated, tt: %jd, cost: %f\n", best_state.travel_time, best_state.cost);
+            printf("Updated, tt: %jd, cost: %f\n", state.travel_time, state.cost);
         }
     }
     if (result) {
@@ -170,15 +305,52 @@ bool inter_cross(Track &track1, Route &route1, Track &track2, Route &route2, opt
     uint32_t size2 = track2.jobs.size();
     std::vector jobs1 = track1.jobs;
     std::vector jobs2 = track2.jobs;
+    std::vector foreign1 = foreign_jobs(jobs1, route2);  // куски jobs1 уходят в route2
+    std::vector foreign2 = foreign_jobs(jobs2, route1);
     State state = route1.state + route2.state;
+    bool glued = segmentable(route1, route2);  // иначе склейка - только отсев
+    std::optional<RouteSegments> segments1, segments2;
+    if (glued || boundable(route1, route2)) {
+        segments1.emplace(route1, track1);
+        segments2.emplace(route2, track2);
+    }
+    ScreenCounters &counters = screen_counters(ScreenOperator::Cross);
     printf("\nCross started, tt: %jd, cost: %f\n", state.travel_time, state.cost);
 
     for (uint32_t it1 = 0; it1 < size1; ++it1) {
+        Segment piece1;  // jobs1[it1, it2] для route2
         for (uint32_t it2 = it1; it2 < size1; ++it2) {
+            if (foreign1[it2 + 1] != foreign1[it1]) {
+                break;  // длиннее кусок тоже не подойдет
+            }
+            if (segments2) {
+                piece1 = segments2->concat(piece1, segments2->job(jobs1[it2]));
+            }
             for (uint32_t it3 = 0; it3 < size2; ++it3) {
+                Segment piece2;  // jobs2[it3, it4] для route1
                 for (uint32_t it4 = it3; it4 < size2; ++it4) {
-                    std::tuple new_jobs = cross(jobs1, jobs2, it1, it2, it3, it4);  // TODO: remove bad opt
-                    std::optional answer = get_states(new_jobs, track1, route1, track2, route2);
+                    if (foreign2[it4 + 1] != foreign2[it3]) {
+                        break;
+                    }
+                    if (segments1) {
+                        piece2 = segments1->concat(piece2, segments1->job(jobs2[it4]));
+                    }
+                    if (!cross_granular(jobs1, route1, jobs2, route2, it1, it2, it3, it4)) {
+                        continue;
+                    }
+                    std::optional<std::tuple<State, State>> answer;
+                    if (glued) {
+                        std::optional new_state1 = segments1->replaced(it1, it2 + 1, piece2);
+                        std::optional new_state2 = segments2->replaced(it3, it4 + 1, piece1);
+                        if (new_state1 && new_state2) {
+                            answer = std::make_tuple(new_state1.value(), new_state2.value());
+                        }
+                    } else if (!segments1 ||
+                               RouteSegments::screen(counters, route1, segments1->bound(it1, it2 + 1, piece2),
+                                                     route2, segments2->bound(it3, it4 + 1, piece1), state)) {
+                        std::tuple new_jobs = cross(jobs1, jobs2, it1, it2, it3, it4);  // TODO: remove bad opt
+                        answer = get_states(new_jobs, track1, route1, track2, route2);
+                    }
                     if (!answer) {  // а еще трек вообще может быть убран из маршрута
                         continue;
                     }
@@ -186,11 +358,15 @@ bool inter_cross(Track &track1, Route &route1, Track &track2, Route &route2, opt
                     auto&[new_state1, new_state2] = answer.value();
                     State new_state = new_state1 + new_state2;
                     if (new_state < state) {
-                        auto&[new_jobs1, new_jobs2] = new_jobs;
-                        track1.jobs = new_jobs1;
-                        track2.jobs = new_jobs2;
+                        std::tie(track1.jobs, track2.jobs) = cross(jobs1, jobs2, it1, it2, it3, it4);
+                        if (glued && !RouteSegments::confirm(route1, route2, state, new_state1, new_state2)) {
+                            track1.jobs = jobs1;  // на округлении выигрыша нет, ищем дальше
+                            track2.jobs = jobs2;
+                            continue;
+                        }
                         route1.state = new_state1;
                         route2.state = new_state2;
+                        new_state = new_state1 + new_state2;
                         printf("Updated, tt: %jd, cost: %f\n", new_state.travel_time, new_state.cost);
                         return true;
                     }
@@ -4,6 +4,7 @@
 #include <local_search/operators/route_utils.h>
 #include <local_search/engine.h>
 #include <local_search/problem.h>
+#include <local_search/segment.h>
 
 
 /**
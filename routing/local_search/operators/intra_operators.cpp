@@ -1,11 +1,52 @@
 #include "intra_operators.h"
 
 
+/**
+ * Создает ли 3-opt ход дугу между соседями: новые дуги соединяют концы разрезанных (x, x+1), (y, y+1), (z, z+1)
+ */
+bool three_opt_granular(const JobIds &jobs, const Route &route, uint32_t x, uint32_t y, uint32_t z) {
+    if (!route.neighbors) {
+        return true;
+    }
+    uint32_t ends[6] = {job_at(jobs, x), job_at(jobs, x + 1),
+                       job_at(jobs, y), job_at(jobs, y + 1),
+                       job_at(jobs, z), job_at(jobs, z + 1)};
+    for (uint32_t p = 0; p < 6; ++p) {
+        for (uint32_t q = p + 1; q < 6; ++q) {
+            if (p % 2 == 0 && q == p + 1) {
+                continue;  // разрезанная дуга
+            }
+            if (granular(route, ends[p], ends[q])) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Середина 3-opt хода склейкой: A = [0, it1], B = [it1 + 1, it3], C = [it3 + 1, it5], D = [it5 + 1, size),
+ * обмены 0-3 из three_opt_exchange - A C B' D, A C B D, A C' B D, A B' C' D (' - задом наперед);
+ * ход - замена [it1 + 1, it5 + 1) на середину
+ */
+Segment three_opt_middle(const RouteSegments &segments, uint32_t exchange, const Segment &b, const Segment &b_reversed,
+                         const Segment &c, const Segment &c_reversed) {
+    const Segment *middle[4][2] = {{&c, &b_reversed}, {&c, &b}, {&c_reversed, &b}, {&b_reversed, &c_reversed}};
+    return segments.concat(*middle[exchange][0], *middle[exchange][1]);
+}
+
 bool three_opt(Track &track, Route &route, optional_end end) {
     State tmp_state = route.state;
-    Jobs tmp_jobs = track.jobs;
+    JobIds tmp_jobs = track.jobs;
     uint32_t size = track.jobs.size();
     bool changed = true;
+    // ходы склейкой кусков, если маршрут позволяет (glued), иначе склейка - только отсев перед get_state
+    bool glued = RouteSegments::usable(route);
+    std::optional<RouteSegments> segments;
+    if (glued || RouteSegments::bounded(route)) {
+        segments.emplace(route, track);
+    }
+    ScreenCounters &counters = screen_counters(ScreenOperator::ThreeOpt);
     printf("\nThree opt started, tt: %jd, cost: %f\n", tmp_state.travel_time, tmp_state.cost);
 
     while (changed) {
@@ -14,19 +55,40 @@ bool three_opt(Track &track, Route &route, optional_end end) {
         std::vector best_jobs = tmp_jobs;
 
         for (uint32_t it1 = 0; it1 < size; ++it1) {
+            Segment b, b_reversed;  // [it1 + 1, it3] и задом наперед
             for (uint32_t it3 = it1 + 1; it3 < size; ++it3) {
+                if (segments) {
+                    b = segments->concat(b, segments->job(tmp_jobs[it3]));
+                    b_reversed = segments->concat(segments->job(tmp_jobs[it3]), b_reversed);
+                }
+                Segment c, c_reversed;  // [it3 + 1, it5] и задом наперед
                 for (uint32_t it5 = it3 + 1; it5 < size; ++it5) {
+                    if (segments) {
+                        c = segments->concat(c, segments->job(tmp_jobs[it5]));
+                        c_reversed = segments->concat(segments->job(tmp_jobs[it5]), c_reversed);
+                    }
+                    if (!three_opt_granular(tmp_jobs, route, it1, it3, it5)) {
+                        continue;
+                    }
                     for (uint32_t i = 0; i < 4; ++i) {
-                        Jobs new_jobs = three_opt_exchange(tmp_jobs, i, it1, it3, it5);
-                        track.jobs = new_jobs;
-                        std::optional new_state = RvrpProblem::get_state(route);
-                        if (!new_state) {
-                            continue;
+                        std::optional<State> new_state;
+                        if (segments) {
+                            Segment middle = three_opt_middle(*segments, i, b, b_reversed, c, c_reversed);
+                            if (glued) {
+                                new_state = segments->replaced(it1 + 1, it5 + 1, middle);
+                            } else if (RouteSegments::screen(counters, route,
+                                                             segments->bound(it1 + 1, it5 + 1, middle), best_state)) {
+                                track.jobs = three_opt_exchange(tmp_jobs, i, it1, it3, it5);
+                                new_state = RvrpProblem::get_state(route);
+                            }
+                        } else {
+                            track.jobs = three_opt_exchange(tmp_jobs, i, it1, it3, it5);
+                            new_state = RvrpProblem::get_state(route);
                         }
-                        if (new_state.value() < best_state) {
+                        if (new_state && new_state.value() < best_state) {
                             changed = true;
                             best_state = new_state.value();
-                            best_jobs = new_jobs;
+                            best_jobs = glued ? three_opt_exchange(tmp_jobs, i, it1, it3, it5) : track.jobs;
                         }
                         track.jobs = tmp_jobs;
                     }
@@ -34,8 +96,17 @@ bool three_opt(Track &track, Route &route, optional_end end) {
             }
         }
         if (changed) {
-            tmp_state = best_state;
+            track.jobs = best_jobs;
+            if (glued) {
+                changed = RouteSegments::confirm(route, tmp_state, best_state);
+            }
+        }
+        if (changed) {
             tmp_jobs = best_jobs;
+            tmp_state = best_state;
+            if (segments) {
+                segments->select(track);
+            }
             if (end && end.value() < system_clock::now()) { changed = false; }
             printf("Updated, tt: %jd, cost: %f\n", best_state.travel_time, best_state.cost);
         }
@@ -52,35 +123,72 @@ bool three_opt(Track &track, Route &route, optional_end end) {
 
 bool two_opt(Track &track, Route &route, optional_end end) {
     State tmp_state = route.state;
-    Jobs tmp_jobs = track.jobs;
+    JobIds tmp_jobs = track.jobs;
     uint32_t size = track.jobs.size();
     bool changed = true;
+    const JobTable &table = *route.job_table;
+    // без окон на симметричной матрице разворот меняет только две дуги (см. RvrpProblem::reversed)
+    bool reversal = route.symmetric && RvrpProblem::window_free(route);
+    int entry = track.storage->location.matrix_id, exit = reversal ? track_exit(track, route) : -1;
+    // иначе ходы склейкой кусков, если маршрут позволяет (glued), или склейка - только отсев перед get_state
+    bool glued = !reversal && RouteSegments::usable(route);
+    std::optional<RouteSegments> segments;
+    if (glued || (!reversal && RouteSegments::bounded(route))) {
+        segments.emplace(route, track);
+    }
+    ScreenCounters &counters = screen_counters(ScreenOperator::TwoOpt);
     printf("\nTwo opt started, tt: %jd, cost: %f\n", tmp_state.travel_time, tmp_state.cost);
 
     while (changed) {
         changed = false;
         State best_state = tmp_state;
-        std::vector best_jobs = tmp_jobs;
+        uint32_t best_it1 = 0, best_it3 = 0;
 
         for (uint32_t it1 = 0; it1 < size; ++it1) {
+            Segment reversed = segments ? segments->job(tmp_jobs[it1]) : Segment();  // [it1, it3] задом наперед
             for (uint32_t it3 = it1 + 1; it3 < size; ++it3) {
-                Jobs new_jobs = swap(tmp_jobs, it1, it3);
-                track.jobs = new_jobs;
-                std::optional new_state = RvrpProblem::get_state(route);
-                if (!new_state) {
+                if (segments) {
+                    reversed = segments->concat(segments->job(tmp_jobs[it3]), reversed);
+                }
+                // разворот [it1, it3] создает дуги (it1 - 1, it3) и (it1, it3 + 1)
+                if (!granular(route, job_at(tmp_jobs, int64_t(it1) - 1), tmp_jobs[it3]) &&
+                    !granular(route, tmp_jobs[it1], job_at(tmp_jobs, it3 + 1))) {
                     continue;
                 }
-                if (new_state.value() < best_state) {
+                std::optional<State> new_state;
+                if (reversal) {
+                    int before = it1 == 0 ? entry : table.location[tmp_jobs[it1 - 1]];
+                    int after = it3 + 1 == size ? exit : table.location[tmp_jobs[it3 + 1]];
+                    new_state = RvrpProblem::reversed(route, tmp_state, before, table.location[tmp_jobs[it1]],
+                                                      table.location[tmp_jobs[it3]], after);
+                } else if (glued) {
+                    new_state = segments->replaced(it1, it3 + 1, reversed);
+                } else if (!segments || RouteSegments::screen(counters, route, segments->bound(it1, it3 + 1, reversed),
+                                                              best_state)) {
+                    track.jobs = swap(tmp_jobs, it1, it3);
+                    new_state = RvrpProblem::get_state(route);
+                    track.jobs = tmp_jobs;
+                }
+                if (new_state && new_state.value() < best_state) {
                     changed = true;
                     best_state = new_state.value();
-                    best_jobs = new_jobs;
+                    best_it1 = it1;
+                    best_it3 = it3;
                 }
-                track.jobs = tmp_jobs;
             }
         }
         if (changed) {
+            track.jobs = swap(tmp_jobs, best_it1, best_it3);
+            if (reversal || glued) {
+                changed = RouteSegments::confirm(route, tmp_state, best_state);
+            }
+        }
+        if (changed) {
+            tmp_jobs = track.jobs;
             tmp_state = best_state;
-            tmp_jobs = best_jobs;
+            if (segments) {
+                segments->select(track);
+            }
             if (end && end.value() < system_clock::now()) { changed = false; }
             printf("Updated, tt: %jd, cost: %f\n", best_state.travel_time, best_state.cost);
         }
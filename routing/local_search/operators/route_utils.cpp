@@ -1,7 +1,7 @@
 #include "route_utils.h"
 
 
-Jobs swap(const Jobs &jobs, uint32_t x, uint32_t y) {
+JobIds swap(const JobIds &jobs, uint32_t x, uint32_t y) {
     std::vector new_jobs = std::vector(jobs);
     uint32_t size = jobs.size();
 
@@ -19,7 +19,7 @@ Jobs swap(const Jobs &jobs, uint32_t x, uint32_t y) {
     return new_jobs;
 }
 
-Jobs three_opt_exchange(const Jobs &jobs, uint32_t best_exchange, uint32_t x, uint32_t y, uint32_t z) {
+JobIds three_opt_exchange(const JobIds &jobs, uint32_t best_exchange, uint32_t x, uint32_t y, uint32_t z) {
     uint32_t size = jobs.size();
 
     uint32_t b = (x + 1) % size;
@@ -48,13 +48,13 @@ Jobs three_opt_exchange(const Jobs &jobs, uint32_t best_exchange, uint32_t x, ui
     }
 }
 
-std::tuple<Jobs, Jobs> cross(const Jobs &jobs1, const Jobs &jobs2, uint32_t it1, uint32_t it2, uint32_t it3, uint32_t it4) {
+std::tuple<JobIds, JobIds> cross(const JobIds &jobs1, const JobIds &jobs2, uint32_t it1, uint32_t it2, uint32_t it3, uint32_t it4) {
     uint32_t size1 = jobs1.size();
     uint32_t size2 = jobs2.size();
     uint32_t new_size1 = size1 - (it2 - it1) + (it4 - it3);
     uint32_t new_size2 = size2 - (it4 - it3) + (it2 - it1);
-    Jobs new_jobs1(new_size1);
-    Jobs new_jobs2(new_size2);
+    JobIds new_jobs1(new_size1);
+    JobIds new_jobs2(new_size2);
 
     for (uint32_t i = 0; i < it1; ++i) {
         new_jobs1[i] = jobs1[i];
@@ -78,11 +78,11 @@ std::tuple<Jobs, Jobs> cross(const Jobs &jobs1, const Jobs &jobs2, uint32_t it1,
     return {new_jobs1, new_jobs2};
 }
 
-std::tuple<Jobs, Jobs> replace_point(const Jobs &jobs1, const Jobs &jobs2, uint32_t it1, uint32_t it2) {
+std::tuple<JobIds, JobIds> replace_point(const JobIds &jobs1, const JobIds &jobs2, uint32_t it1, uint32_t it2) {
     uint32_t size1 = jobs1.size();
     uint32_t size2 = jobs2.size();
-    Jobs new_jobs1(size1 + 1);
-    Jobs new_jobs2(size2 - 1);
+    JobIds new_jobs1(size1 + 1);
+    JobIds new_jobs2(size2 - 1);
 
     for (uint32_t i = 0; i < size1 + 1; ++i) {
         if (i == it1) {
@@ -105,9 +105,9 @@ std::tuple<Jobs, Jobs> replace_point(const Jobs &jobs1, const Jobs &jobs2, uint3
     return {new_jobs1, new_jobs2};
 }
 
-Jobs insert(uint32_t place, const ptrJob &job, const Jobs &jobs) {
+JobIds insert(uint32_t place, uint32_t job, const JobIds &jobs) {
     uint32_t size = jobs.size() + 1;
-    Jobs new_route = Jobs(size);
+    JobIds new_route = JobIds(size);
     for (uint32_t i = 0; i < size; ++i) {
         if (i < place) {
             new_route[i] = jobs[i];
@@ -119,3 +119,26 @@ Jobs insert(uint32_t place, const ptrJob &job, const Jobs &jobs) {
     }
     return new_route;
 }
+
+uint32_t job_at(const JobIds &jobs, int64_t it) {
+    if (it < 0 || it >= int64_t(jobs.size())) {
+        return NO_JOB;
+    }
+    return jobs[it];
+}
+
+bool granular(const Route &route, uint32_t from, uint32_t to) {
+    return !route.neighbors || route.neighbors->close(from, to);
+}
+
+int track_exit(const Track &track, const Route &route) {
+    if (route.circle_track) {
+        return track.storage->location.matrix_id;
+    }
+    for (auto next = route.tracks.begin() + (&track - route.tracks.data()) + 1; next != route.tracks.end(); ++next) {
+        if (!next->jobs.empty()) {
+            return next->storage->location.matrix_id;
+        }
+    }
+    return route.courier->end_location.matrix_id;
+}
@@ -12,7 +12,7 @@
  * @param jobs массив задач
  * @return массив задач со вставленной задачей
  */
-Jobs insert(uint32_t place, const ptrJob &job, const Jobs &jobs);
+JobIds insert(uint32_t place, uint32_t job, const JobIds &jobs);
 
 /**
  * Разворот куска массива задач в списке задач
@@ -21,7 +21,7 @@ Jobs insert(uint32_t place, const ptrJob &job, const Jobs &jobs);
  * @param y до включительно
  * @return новый массив задач
  */
-Jobs swap(const Jobs &jobs, uint32_t x, uint32_t y);
+JobIds swap(const JobIds &jobs, uint32_t x, uint32_t y);
 
 /**
  * Изменения массива задач для 3-opt оптимизации
@@ -32,7 +32,7 @@ Jobs swap(const Jobs &jobs, uint32_t x, uint32_t y);
  * @param z
  * @return новый массив задач
  */
-Jobs three_opt_exchange(const Jobs &jobs, uint32_t best_exchange, uint32_t x, uint32_t y, uint32_t z);
+JobIds three_opt_exchange(const JobIds &jobs, uint32_t best_exchange, uint32_t x, uint32_t y, uint32_t z);
 
 /**
  * Cross-exchange для двух массивов задач
@@ -44,7 +44,7 @@ Jobs three_opt_exchange(const Jobs &jobs, uint32_t best_exchange, uint32_t x, ui
  * @param it4 до во втором
  * @return новые измененные массивы
  */
-std::tuple<Jobs, Jobs> cross(const Jobs &jobs1, const Jobs &jobs2, uint32_t it1, uint32_t it2, uint32_t it3, uint32_t it4);
+std::tuple<JobIds, JobIds> cross(const JobIds &jobs1, const JobIds &jobs2, uint32_t it1, uint32_t it2, uint32_t it3, uint32_t it4);
 
 /**
  * Перемещение точки из одного массива в другой (2 -> 1)
@@ -54,6 +54,25 @@ std::tuple<Jobs, Jobs> cross(const Jobs &jobs1, const Jobs &jobs2, uint32_t it1,
  * @param it2 откуда вытащить
  * @return новые массивы
  */
-std::tuple<Jobs, Jobs> replace_point(const Jobs &jobs1, const Jobs &jobs2, uint32_t it1, uint32_t it2);
+std::tuple<JobIds, JobIds> replace_point(const JobIds &jobs1, const JobIds &jobs2, uint32_t it1, uint32_t it2);
+
+/**
+ * Задача на позиции it
+ * @return номер задачи или NO_JOB, если позиция за краем (там склад или следующий трек)
+ */
+uint32_t job_at(const JobIds &jobs, int64_t it);
+
+/**
+ * Допускают ли гранулярные соседи маршрута дугу from -> to; если соседей нет, допустима любая
+ */
+bool granular(const Route &route, uint32_t from, uint32_t to);
+
+/**
+ * Куда курьер едет после последней задачи подмаршрута: на его склад (circle_track),
+ * на склад следующего непустого подмаршрута или в конечную точку
+ * @param track подмаршрут из route.tracks
+ * @return matrix_id точки
+ */
+int track_exit(const Track &track, const Route &route);
 
 #endif //MADRICH_SOLVER_VRP_UTILS_H
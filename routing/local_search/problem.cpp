@@ -1,5 +1,52 @@
 #include "problem.h"
 #include <ranges>
+#include <utility>
+
+
+/**
+ * Вариант pick<Dimension, CircleTrack>() под runtime vec и circle_track:
+ * vec из Dimensions - специализированный, остальные - общий Dimension = 0
+ */
+template<typename Pick, uint32_t... Dimensions>
+auto dispatch(uint16_t vec, bool circle_track, Pick pick, std::integer_sequence<uint32_t, Dimensions...>) {
+    auto ret = circle_track ? pick.template operator()<0, true>() : pick.template operator()<0, false>();
+    ((vec == Dimensions ? void(ret = circle_track ? pick.template operator()<Dimensions, true>()
+                                                  : pick.template operator()<Dimensions, false>()) : void()), ...);
+    return ret;
+}
+
+template<typename Pick>
+auto dispatch(uint16_t vec, bool circle_track, Pick pick) {
+    return dispatch(vec, circle_track, pick, std::make_integer_sequence<uint32_t, SPECIALIZED_DIMENSION + 1>());
+}
+
+/**
+ * state += rhs; при Dimension != 0 груз складывается циклом известной длины
+ */
+template<uint32_t Dimension>
+void accumulate(State &state, const State &rhs) {
+    if constexpr (Dimension == 0) {
+        state += rhs;
+    } else {
+        state.travel_time += rhs.travel_time;
+        state.distance += rhs.distance;
+        state.cost += rhs.cost;
+        if (state.value && rhs.value) {
+            for (uint32_t i = 0; i < Dimension; ++i) {
+                state.value.value()[i] += rhs.value.value()[i];
+            }
+        } else if (rhs.value) {
+            state.value = rhs.value;
+        }
+    }
+}
+
+template<uint32_t Dimension>
+State sum(const State &lhs, const State &rhs) {
+    State ret = lhs;
+    accumulate<Dimension>(ret, rhs);
+    return ret;
+}
 
 
 MadrichEngine RvrpProblem::init_tour(
@@ -12,9 +59,13 @@ MadrichEngine RvrpProblem::init_tour(
     MadrichEngine tour(storages, couriers.size());
     printf("\nCreating MadrichEngine, Couriers: %zu, Jobs: %lu\n", couriers.size(), tour.unassigned_jobs());
 
+    Matrices shared = share_matrices(matrices, couriers);
+    std::map symmetric = symmetric_matrices(shared);
     uint32_t i = 0;
     for (auto &courier : couriers) {
-        tour.routes[i++] = init_route(vec, courier, matrices, circle_track);
+        tour.job_table->add(courier);
+        tour.routes[i] = init_route(vec, courier, shared, circle_track, tour.job_table);
+        tour.routes[i++].symmetric = symmetric[courier->profile];
     }
 
     printf("Created MadrichEngine, Routes: %zu, Assigned: %lu\n\n", tour.routes.size(), tour.assigned_jobs());
@@ -24,36 +75,47 @@ MadrichEngine RvrpProblem::init_tour(
 Route RvrpProblem::init_route(
         uint16_t vec,
         ptrCourier &courier,
-        std::map<std::string, Matrix> &matrices,
-        bool circle_track
+        Matrices &matrices,
+        bool circle_track,
+        ptrJobTable job_table
 ) {
+    auto build = dispatch(vec, circle_track, []<uint32_t Dimension, bool CircleTrack>() {
+        return &build_route<Dimension, CircleTrack>;
+    });
+    return build(vec, courier, matrices, std::move(job_table));
+}
+
+template<uint32_t Dimension, bool CircleTrack>
+Route RvrpProblem::build_route(uint16_t vec, ptrCourier &courier, Matrices &matrices, ptrJobTable job_table) {
     printf("Creating Route, Courier: %s, type: %s\n", courier->name.c_str(), courier->profile.c_str());
-    Matrix &matrix = matrices[courier->profile];
-    Route route(vec, std::get<0>(courier->work_time.window), circle_track, courier, matrix);
+    Route route(vec, std::get<0>(courier->work_time.window), CircleTrack, courier, matrices[courier->profile],
+                std::move(job_table));
+    const JobTable &table = *route.job_table;
+    route.evaluator = &evaluate<Dimension, CircleTrack>;
     printf("Unassigned: %lu\n", route.unassigned_jobs());
     int curr_point = courier->start_location.matrix_id;
     State state(0, 0, courier->cost.start);
 
     while (true) {
-        state.value = std::vector<int>(vec);  // создаем новый подмаршрут
-        auto tmp = init_track(curr_point, state, route);  // с одной точкой
+        state.value = Load(vec);  // создаем новый подмаршрут
+        auto tmp = init_track<Dimension, CircleTrack>(curr_point, state, route);  // с одной точкой
         if (!tmp) { break; }
         auto&[new_state, track] = tmp.value();
         state = new_state;
-        curr_point = track.jobs[0]->location.matrix_id;
+        curr_point = table.location[track.jobs[0]];
         printf(".");
 
         while (true) {  // ищем новые точки
-            std::optional answer = choose_job(curr_point, state, track, route);
+            std::optional answer = choose_job<Dimension, CircleTrack>(curr_point, state, track, route);
             if (!answer) { break; }
             state = answer.value();
-            curr_point = track.jobs.back()->location.matrix_id;
+            curr_point = table.location[track.jobs.back()];
             printf(".");
         }  // больше нет доступных точек
 
-        if (circle_track) {  // возможно обязаны вернуться на склад
+        if constexpr (CircleTrack) {  // возможно обязаны вернуться на склад
             auto answer = go_storage(curr_point, state, track.storage, route);
-            state += answer.value();  // учитывается в выборе точки
+            accumulate<Dimension>(state, answer.value());  // учитывается в выборе точки
             curr_point = track.storage->location.matrix_id;
         }
 
@@ -64,13 +126,22 @@ Route RvrpProblem::init_route(
     if (route.tracks.empty()) {
         return route;
     }
-    auto answer = end(curr_point, state, route);
-    state += answer.value();
+    auto answer = end<Dimension>(curr_point, state, route);
+    accumulate<Dimension>(state, answer.value());
     route.state += state;
     printf("\nCreated Route, Jobs: %lu/%lu\n", route.assigned_jobs(), route.unassigned_jobs());
     return route;
 }
 
+std::optional<std::tuple<State, Track>>
+RvrpProblem::init_track(int current_point, const State &state, Route &route) {
+    auto init = dispatch(route.vec, route.circle_track, []<uint32_t Dimension, bool CircleTrack>() {
+        return &init_track<Dimension, CircleTrack>;
+    });
+    return init(current_point, state, route);
+}
+
+template<uint32_t Dimension, bool CircleTrack>
 std::optional<std::tuple<State, Track>>
 RvrpProblem::init_track(int current_point, const State &state, Route &route) {
     std::vector states = sorted_storages(current_point, state, route);
@@ -78,15 +149,21 @@ RvrpProblem::init_track(int current_point, const State &state, Route &route) {
         return std::nullopt;
     }
 
+    const JobTable &table = *route.job_table;
+    uint32_t courier = table.index(route.courier);
     for (const auto &st : states) {
         int storage_id = std::get<1>(st);
         const ptrStorage &storage = route.courier->storages[storage_id];  // едем на склад
+        if (!table.visits(courier, table.index(storage))) {
+            continue;
+        }
         std::optional answer = go_storage(current_point, state, storage, route);
         if (!answer) {
             continue;
         }
         Track track(storage);  // пытаемся найти хоть одну доступную задачу
-        answer = choose_job(storage->location.matrix_id, state + answer.value(), track, route);
+        answer = choose_job<Dimension, CircleTrack>(storage->location.matrix_id, sum<Dimension>(state, answer.value()),
+                                                    track, route);
         if (answer) {
             return std::tuple(answer.value(), track);
         }
@@ -95,50 +172,113 @@ RvrpProblem::init_track(int current_point, const State &state, Route &route) {
     return std::nullopt;
 }
 
+template<uint32_t Dimension, bool CircleTrack>
 std::optional<State> RvrpProblem::choose_job(int location, const State &state, Track &track, Route &route) {
     std::optional<State> best_state = std::nullopt;
+    const JobTable &table = *route.job_table;
     const ptrStorage &storage = track.storage;
-    std::size_t size = storage->unassigned_jobs.size();
     int index = -1;
+    uint32_t chosen = NO_JOB;
+
+    uint32_t courier = table.index(route.courier);
+
+    // кандидаты - только задачи, которые курьер может взять (см. JobTable::serves)
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> ids;  // их номера в таблице
+    std::vector<uint32_t> dst;
+    for (std::size_t i = 0; i < storage->unassigned_jobs.size(); ++i) {
+        uint32_t job = table.index(storage->unassigned_jobs[i]);
+        if (table.serves(courier, job)) {
+            candidates.push_back(i);
+            ids.push_back(job);
+            dst.push_back(table.location[job]);
+        }
+    }
+    std::size_t size = candidates.size();
+
+    // все перегоны из location одним пакетом
+    std::vector<time_t> times(size);
+    std::vector<int> distances(size);
+    route.matrix->get_one_to_many(location, dst, times, distances, route.start_time + state.travel_time);
 
     for (std::size_t i = 0; i < size; ++i) {
-        const ptrJob &job = storage->unassigned_jobs[i];  // едем на задачу
-        std::optional answer = go_job(location, state, job, storage, route);
+        uint32_t job = ids[i];  // едем на задачу
+        std::optional answer = go_job<Dimension>(location, state, job, times[i], distances[i], route);
         if (!answer) { continue; }
-        State new_state = state + answer.value();
+        State new_state = sum<Dimension>(state, answer.value());
         State end_track = new_state;
-        int current_point = job->location.matrix_id;
+        int current_point = dst[i];
 
         if (!(!best_state || new_state < best_state)) { continue; }
 
-        if (route.circle_track) {  // тогда нам нужно вернуться на склад
-            answer = go_storage(job->location.matrix_id, new_state, storage, route);
+        if constexpr (CircleTrack) {  // тогда нам нужно вернуться на склад
+            answer = go_storage(current_point, new_state, storage, route);
             if (!answer) { continue; }
-            end_track += answer.value();
+            accumulate<Dimension>(end_track, answer.value());
             current_point = track.storage->location.matrix_id;
         }
 
-        if (end(current_point, end_track, route)) {  // и всегда должна быть возможность закончить
+        if (end<Dimension>(current_point, end_track, route)) {  // и всегда должна быть возможность закончить
             best_state = new_state;
-            index = i;
+            index = int(candidates[i]);
+            chosen = ids[i];
         }
     }
 
     if (index == -1) {
         return std::nullopt;
     }
-    track.jobs.push_back(storage->unassigned_jobs[index]);
+    track.jobs.push_back(chosen);
     storage->unassigned_jobs.erase(storage->unassigned_jobs.begin() + index);
     return best_state;
 }
 
 std::optional<State> RvrpProblem::get_state(const Route &route) {
+    RouteEvaluator evaluate = route.evaluator ? route.evaluator : evaluator(route.vec, route.circle_track);
+    return route.cache ? route.cache->evaluate(route, evaluate) : evaluate(route);
+}
+
+RouteEvaluator RvrpProblem::evaluator(uint16_t vec, bool circle_track) {
+    return dispatch(vec, circle_track, []<uint32_t Dimension, bool CircleTrack>() -> RouteEvaluator {
+        return &evaluate<Dimension, CircleTrack>;
+    });
+}
+
+bool RvrpProblem::window_free(const Route &route) {
+    return route.job_table && route.job_table->window_free(route.job_table->index(route.courier)) &&
+           std::get<0>(route.courier->work_time.window) <= route.start_time;
+}
+
+std::optional<State>
+RvrpProblem::reversed(const Route &route, const State &state, int before, int first, int last, int after) {
+    auto arc = [&route](int src, int dst) {
+        auto [tt, d] = route.matrix->get_time_distance(src, dst, route.start_time);
+        return State(tt, d, cost(src, dst, route.start_time, tt, d, route));
+    };
+    State ret = state + arc(before, last) + arc(first, after) - arc(before, first) - arc(last, after);
+    if (!validate_courier(ret, route)) {
+        return std::nullopt;
+    }
+    return ret;
+}
+
+template<uint32_t Dimension, bool CircleTrack>
+std::optional<State> RvrpProblem::evaluate(const Route &route) {
     auto size_t = route.tracks.size();
     if (size_t == 0) {
         State st(0, 0, 0.0);
         return st;
     }
+    if (window_free(route)) {
+        return evaluate_free<Dimension, CircleTrack>(route);
+    }
+    return evaluate_windows<Dimension, CircleTrack>(route);
+}
 
+template<uint32_t Dimension, bool CircleTrack>
+std::optional<State> RvrpProblem::evaluate_windows(const Route &route) {
+    const JobTable &table = *route.job_table;
+    uint32_t courier = table.index(route.courier);
     int curr_point = route.courier->start_location.matrix_id;  // старт
     State state;
 
@@ -146,83 +286,150 @@ std::optional<State> RvrpProblem::get_state(const Route &route) {
         if (track.jobs.empty()) {
             continue;
         }
+        if (!table.visits(courier, table.index(track.storage))) {
+            return std::nullopt;
+        }
 
-        state.value = std::vector<int>(route.vec);
+        state.value = Load(Dimension == 0 ? route.vec : Dimension);
         auto answer = go_storage(curr_point, state, track.storage, route);
         if (!answer) {
             return std::nullopt;
         }
-        state += answer.value();
+        accumulate<Dimension>(state, answer.value());
         curr_point = track.storage->location.matrix_id;  // едем на склад
 
-        for (const auto &job : track.jobs) {
-            answer = go_job(curr_point, state, job, track.storage, route);
+        for (uint32_t job : track.jobs) {
+            if (!table.serves(courier, job)) {
+                return std::nullopt;
+            }
+            answer = go_job<Dimension>(curr_point, state, job, route);
             if (!answer) {
                 return std::nullopt;
             }
-            state += answer.value();
-            curr_point = job->location.matrix_id;  // едем на каждую задачу
+            accumulate<Dimension>(state, answer.value());
+            curr_point = table.location[job];  // едем на каждую задачу
         }
 
-        if (route.circle_track) {
+        if constexpr (CircleTrack) {
             answer = go_storage(curr_point, state, track.storage, route);
             if (!answer) {
                 return std::nullopt;
             }
             curr_point = track.storage->location.matrix_id;  // возможно возвращаемся
-            state += answer.value();
+            accumulate<Dimension>(state, answer.value());
         }
     }
 
-    if (!validate_courier(state, route)) {
+    if (!validate_courier<Dimension>(state, route)) {
         return std::nullopt;
     }
-    auto answer = end(curr_point, state, route);  // конечная точка
+    auto answer = end<Dimension>(curr_point, state, route);  // конечная точка
     if (!answer) {
         return std::nullopt;
     }
-    state += answer.value();
+    accumulate<Dimension>(state, answer.value());
     state.value = std::nullopt;
     return state;
 }
 
+template<uint32_t Dimension, bool CircleTrack>
+std::optional<State> RvrpProblem::evaluate_free(const Route &route) {
+    const JobTable &table = *route.job_table;
+    const uint32_t courier = table.index(route.courier);
+    const uint32_t dimension = Dimension == 0 ? route.vec : Dimension;
+    const std::vector<int> &capacity = route.courier->value;
+    int curr_point = route.courier->start_location.matrix_id;  // старт
+    State state;
+    Load load;
+
+    // перегон curr_point -> dst с обслуживанием; стоимость складывается так же, как в go_job и go_storage
+    auto go = [&](int dst, time_t service) {
+        time_t departure = route.start_time + state.travel_time;
+        auto [tt, d] = route.matrix->get_time_distance(curr_point, dst, departure);
+        if (tt == -1) {
+            return false;
+        }
+        state.travel_time += tt + service;
+        state.distance += d;
+        state.cost += cost(curr_point, dst, departure, tt, d, route) + cost(service, 0, route);
+        curr_point = dst;
+        return true;
+    };
+
+    for (const auto &track : route.tracks) {
+        if (track.jobs.empty()) {
+            continue;
+        }
+        const ptrStorage &storage = track.storage;
+        if (!table.visits(courier, table.index(storage)) || !go(storage->location.matrix_id, storage->load)) {
+            return std::nullopt;
+        }
+        load = Load(dimension);
+
+        for (uint32_t job : track.jobs) {
+            if (!table.serves(courier, job) || !go(table.location[job], table.delay[job])) {
+                return std::nullopt;
+            }
+            const Load &demand = table.demand[job];
+            for (uint32_t i = 0; i < dimension; ++i) {  // груз проверяется на каждом шаге, как в go_job
+                load[i] += demand[i];
+                if (load[i] > capacity[i]) {
+                    return std::nullopt;
+                }
+            }
+        }
+
+        if constexpr (CircleTrack) {
+            if (!go(storage->location.matrix_id, storage->load)) {
+                return std::nullopt;
+            }
+        }
+    }
+
+    if (!go(route.courier->end_location.matrix_id, 0) || !validate_courier<Dimension>(state, route)) {
+        return std::nullopt;
+    }
+    return state;
+}
+
 std::vector<std::tuple<time_t, std::size_t>>
 RvrpProblem::sorted_storages(int curr_point, const State &state, const Route &route) {
-    const Matrix &matrix = route.matrix;
+    const Storages &storages = route.courier->storages;
     std::vector<std::tuple<time_t, std::size_t>> states;
 
-    for (std::size_t i = 0; i < route.courier->storages.size(); ++i) {
-        if (route.courier->storages[i]->unassigned_jobs.empty()) {  // отсекаем пустые
+    std::vector<uint32_t> dst(storages.size());
+    std::vector<time_t> times(storages.size());
+    std::vector<int> distances(storages.size());
+    for (std::size_t i = 0; i < storages.size(); ++i) {
+        dst[i] = storages[i]->location.matrix_id;
+    }
+    route.matrix->get_one_to_many(curr_point, dst, times, distances, route.start_time + state.travel_time);
+
+    for (std::size_t i = 0; i < storages.size(); ++i) {
+        if (storages[i]->unassigned_jobs.empty()) {  // отсекаем пустые
+            continue;
+        }
+        if (times[i] == -1) {  // матрица уже не действует
             continue;
         }
-        time_t tt = matrix.get_time(curr_point, route.courier->storages[i]->location.matrix_id);
-        states.emplace_back(tt, i);
+        states.emplace_back(times[i], i);
     }
 
     sort(states.begin(), states.end());
     return states;
 }
 
-bool RvrpProblem::validate_skills(const ptrJob &job, const ptrCourier &courier) {
-    return std::ranges::all_of(
-            job->skills.begin(),
-            job->skills.end(),
-            [&courier](const std::string &skill) {
-                return std::ranges::find(courier->skills, skill) != courier->skills.end();
-            }
-    );
+bool RvrpProblem::validate_skills(uint32_t job, const Route &route) {
+    const JobTable &table = *route.job_table;
+    return table.courier_skills[table.index(route.courier)].covers(table.skills[job]);
 }
 
-bool RvrpProblem::validate_skills(const ptrStorage &storage, const ptrCourier &courier) {
-    return std::ranges::all_of(
-            storage->skills.begin(),
-            storage->skills.end(),
-            [&courier](const std::string &skill) {
-                return std::ranges::find(courier->skills, skill) != courier->skills.end();
-            }
-    );
+bool RvrpProblem::validate_skills(const ptrStorage &storage, const Route &route) {
+    const JobTable &table = *route.job_table;
+    return table.courier_skills[table.index(route.courier)].covers(table.storage_skills[table.index(storage)]);
 }
 
+template<uint32_t Dimension>
 bool RvrpProblem::validate_courier(const State &state, const Route &route) {
     // 1. проверяем время работы
     const auto&[start_shift, end_shift] = route.courier->work_time.window;
@@ -239,9 +446,9 @@ bool RvrpProblem::validate_courier(const State &state, const Route &route) {
     if (!state.value) {
         return true;
     }
-    auto size_v = state.value.value().size();
-    for (std::size_t i = 0; i < size_v; ++i) {
-        if (state.value.value()[i] > route.courier->value[i]) {
+    const Load &load = state.value.value();
+    for (uint32_t i = 0; i < (Dimension == 0 ? load.size() : Dimension); ++i) {
+        if (load[i] > route.courier->value[i]) {
             return false;
         }
     }
@@ -252,29 +459,48 @@ bool RvrpProblem::validate_storage(const ptrStorage &storage, const ptrCourier &
     return std::ranges::find(courier->storages, storage) != courier->storages.end();
 }
 
+template<uint32_t Dimension>
+std::optional<State>
+RvrpProblem::go_job(
+        int curr_point,
+        const State &state,
+        uint32_t job,
+        const Route &route
+) {
+    // время в пути зависит от момента выезда
+    auto [tt, d] = route.matrix->get_time_distance(curr_point, route.job_table->location[job],
+                                                   route.start_time + state.travel_time);
+    return go_job<Dimension>(curr_point, state, job, tt, d, route);
+}
+
+template<uint32_t Dimension>
 std::optional<State>
 RvrpProblem::go_job(
         int curr_point,
         const State &state,
-        const ptrJob &job,
-        const ptrStorage &storage,
+        uint32_t job,
+        time_t tt,
+        int d,
         const Route &route
 ) {
-    if (!RvrpProblem::validate_skills(job, route.courier)) {
+    const JobTable &table = *route.job_table;
+    if (tt == -1) {
         return std::nullopt;
     }
     // доехать + отдать заказ
-    time_t tt = route.matrix.get_time(curr_point, job->location.matrix_id) + job->delay;
-    int d = route.matrix.get_distance(storage->location.matrix_id, job->location.matrix_id);
+    time_t departure = route.start_time + state.travel_time;
+    float c = RvrpProblem::cost(curr_point, table.location[job], departure, tt, d, route);
+    time_t extra = table.delay[job];
     // возможно придется подождать
-    time_t waiting = RvrpProblem::waiting(state.travel_time + tt, route.start_time, job->time_windows);
+    time_t waiting = RvrpProblem::waiting(state.travel_time + tt + extra, route.start_time, table.time_windows(job));
     if (waiting == -1) {
         return std::nullopt;
     }
-    tt += waiting;
-    State tmp(tt, d, RvrpProblem::cost(tt, d, route), std::optional<std::vector<int>>(job->value));
+    extra += waiting;
+    c += RvrpProblem::cost(extra, 0, route);
+    State tmp(tt + extra, d, c, table.demand[job]);
     // курьер уложится по времени, расстоянию, грузу?
-    if (!RvrpProblem::validate_courier(tmp + state, route)) {
+    if (!RvrpProblem::validate_courier<Dimension>(sum<Dimension>(tmp, state), route)) {
         return std::nullopt;
     }
     return tmp;
@@ -282,19 +508,21 @@ RvrpProblem::go_job(
 
 std::optional<State>
 RvrpProblem::go_storage(int curr_point, const State &state, const ptrStorage &storage, const Route &route) {
-    if (!RvrpProblem::validate_skills(storage, route.courier)) {
+    // доехать + перезагрузиться
+    time_t departure = route.start_time + state.travel_time;
+    auto [tt, d] = route.matrix->get_time_distance(curr_point, storage->location.matrix_id, departure);
+    if (tt == -1) {
         return std::nullopt;
     }
-    // доехать + перезагрузиться
-    time_t tt = route.matrix.get_time(curr_point, storage->location.matrix_id) + storage->load;
-    int d = route.matrix.get_distance(storage->location.matrix_id, storage->location.matrix_id);
+    float c = RvrpProblem::cost(curr_point, storage->location.matrix_id, departure, tt, d, route);
+    time_t extra = storage->load;
     // подождать до открытия
-    time_t waiting = RvrpProblem::waiting(state.travel_time + tt, route.start_time, storage->work_time);
+    time_t waiting = RvrpProblem::waiting(state.travel_time + tt + extra, route.start_time, storage->work_time);
     if (waiting == -1) {
         return std::nullopt;
     }
-    tt += waiting;
-    State tmp(tt, d, RvrpProblem::cost(tt, d, route));
+    extra += waiting;
+    State tmp(tt + extra, d, c + RvrpProblem::cost(extra, 0, route));
     return tmp;
 }
 
@@ -302,12 +530,19 @@ float RvrpProblem::cost(time_t travel_time, int distance, const Route &route) {
     return float(travel_time) * route.courier->cost.second + float(distance) * route.courier->cost.meter;
 }
 
-time_t RvrpProblem::waiting(time_t arrival_time, time_t start_time, const std::vector<Window> &time_windows) {
+float RvrpProblem::cost(int src, int dst, time_t curr_time, time_t travel_time, int distance, const Route &route) {
+    if (route.costs) {
+        return route.costs->get_cost(src, dst, curr_time);
+    }
+    return cost(travel_time, distance, route);
+}
+
+time_t RvrpProblem::waiting(time_t arrival_time, time_t start_time, std::span<const Window> time_windows) {
     time_t waiting = -1;
 
     for (const auto &window : time_windows) {
         const auto&[start_shift, end_shift] = window.window;
-        if (start_shift <= start_time + arrival_time <= end_shift) {
+        if (start_shift <= start_time + arrival_time && start_time + arrival_time <= end_shift) {
             return 0;  // точное попадание в окно
         }
         time_t new_waiting = start_shift - (start_time + arrival_time);
@@ -326,7 +561,7 @@ time_t RvrpProblem::waiting(time_t arrival_time, time_t start_time, const std::v
 
 time_t RvrpProblem::waiting(time_t arrival_time, time_t start_time, const Window &time_window) {
     const auto&[start_shift, end_shift] = time_window.window;
-    if (start_shift <= start_time + arrival_time <= end_shift) {
+    if (start_shift <= start_time + arrival_time && start_time + arrival_time <= end_shift) {
         return 0;  // точное попадание
     }
     time_t waiting = start_shift - (start_time + arrival_time);
@@ -334,29 +569,50 @@ time_t RvrpProblem::waiting(time_t arrival_time, time_t start_time, const Window
 }
 
 State RvrpProblem::get_state_track(const Track &track, const Route &route) {
+    const JobTable &table = *route.job_table;
     int location = track.storage->location.matrix_id;
     State state;
-    for (const auto &job : track.jobs) {
-        time_t tt = route.matrix.get_time(location, job->location.matrix_id) + job->delay;
-        int d = route.matrix.get_distance(location, job->location.matrix_id);
-        float c = cost(tt, d, route);
-        location = job->location.matrix_id;
-        state += State(tt, d, c, job->value);
+    for (uint32_t job : track.jobs) {  // без ожиданий, но с отсчетом от начала маршрута
+        time_t departure = route.start_time + state.travel_time;
+        auto [tt, d] = route.matrix->get_time_distance(location, table.location[job], departure);
+        float c = cost(location, table.location[job], departure, tt, d, route) + cost(table.delay[job], 0, route);
+        location = table.location[job];
+        state += State(tt + table.delay[job], d, c, table.demand[job]);
     }
     if (route.circle_track) {  // не забываем про такую возможность
-        state.travel_time += route.matrix.get_time(location, track.storage->location.matrix_id);
-        state.distance += route.matrix.get_distance(location, track.storage->location.matrix_id);
+        auto [tt, d] = route.matrix->get_time_distance(location, track.storage->location.matrix_id,
+                                                       route.start_time + state.travel_time);
+        state.travel_time += tt;
+        state.distance += d;
     }
     return state;
 }
 
+template<uint32_t Dimension>
 std::optional<State> RvrpProblem::end(int curr_point, const State &state, const Route &route) {
     int end_id = route.courier->end_location.matrix_id;
-    time_t tt = route.matrix.get_time(curr_point, end_id);
-    int d = route.matrix.get_distance(curr_point, end_id);
-    State st(tt, d, cost(tt, d, route));
-    if (!validate_courier(state + st, route)) {
+    time_t departure = route.start_time + state.travel_time;
+    auto [tt, d] = route.matrix->get_time_distance(curr_point, end_id, departure);
+    if (tt == -1) {
+        return std::nullopt;
+    }
+    State st(tt, d, cost(curr_point, end_id, departure, tt, d, route));
+    if (!validate_courier<Dimension>(sum<Dimension>(state, st), route)) {
         return std::nullopt;
     }
     return st;
 }
+
+template bool RvrpProblem::validate_courier<0>(const State &state, const Route &route);
+
+template std::optional<State> RvrpProblem::evaluate<0, true>(const Route &route);
+
+template std::optional<State> RvrpProblem::evaluate<0, false>(const Route &route);
+
+template std::optional<State> RvrpProblem::evaluate_windows<0, true>(const Route &route);
+
+template std::optional<State> RvrpProblem::evaluate_windows<0, false>(const Route &route);
+
+template std::optional<State> RvrpProblem::evaluate_free<0, true>(const Route &route);
+
+template std::optional<State> RvrpProblem::evaluate_free<0, false>(const Route &route);
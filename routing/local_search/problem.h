@@ -21,8 +21,18 @@
  */
 
 
+/**
+ * Размерности вектора вместимости до этой включительно оцениваются специализированным кодом,
+ * большие - общим вариантом (Dimension = 0, размерность из маршрута)
+ */
+constexpr uint32_t SPECIALIZED_DIMENSION = 4;
+
+
 /**
  * Создание тура, валиадция, оценка и пр.
+ * Горячие функции - шаблоны по размерности вектора вместимости (Dimension, 0 - из маршрута) и возврату
+ * на склад (CircleTrack): с константами циклы по грузу разворачиваются, а ветки по circle_track исчезают.
+ * Вариант выбирается один раз по vec и circle_track (evaluator) и запоминается в маршруте
  */
 class RvrpProblem {
 public:
@@ -47,15 +57,17 @@ public:
      * Создание маршрута
      * @param vec размер вектора вместимости
      * @param courier курьер для этого маршрута
-     * @param matrices матрицы
+     * @param matrices общие матрицы по профилям
      * @param circle_track обязан ли курьер возвращаться на склад
+     * @param job_table таблица задач тура (курьер и задачи его складов уже в ней)
      * @return новый маршрут
      */
     static Route init_route(
             uint16_t vec,
             ptrCourier &courier,
-            std::map<std::string, Matrix> &matrices,
-            bool circle_track
+            Matrices &matrices,
+            bool circle_track,
+            ptrJobTable job_table
     );
 
     /**
@@ -69,12 +81,58 @@ public:
     init_track(int current_point, const State &state, Route &route);
 
     /**
-     * Оценка и валидация всего маршрута
+     * Оценка и валидация всего маршрута через route.evaluator (если его нет, вариант выбирается на месте);
+     * с памятью оценок (Route::cache) уже оцененный маршрут берется из нее
      * @param route маршрут
      * @return состояние
      */
     static std::optional<State> get_state(const Route &route);
 
+    /**
+     * Оценка и валидация всего маршрута, вариант под Dimension и CircleTrack
+     * Маршрут без окон (window_free) идет через evaluate_free, остальные - через evaluate_windows
+     * @param route маршрут с vec == Dimension (или любым при Dimension = 0) и circle_track == CircleTrack
+     * @return состояние
+     */
+    template<uint32_t Dimension, bool CircleTrack>
+    static std::optional<State> evaluate(const Route &route);
+
+    /**
+     * Оценка с окнами: ожидания и проверки курьера на каждом шаге
+     */
+    template<uint32_t Dimension, bool CircleTrack>
+    static std::optional<State> evaluate_windows(const Route &route);
+
+    /**
+     * Оценка маршрута без окон (window_free): только время, расстояние, стоимость и груз,
+     * без ожиданий и без проверок смены и расстояния на каждом шаге - они монотонны, хватает проверки в конце
+     * Результат тот же, что у evaluate_windows (стоимость складывается в том же порядке)
+     */
+    template<uint32_t Dimension, bool CircleTrack>
+    static std::optional<State> evaluate_free(const Route &route);
+
+    /**
+     * Вариант evaluate для маршрутов с такими vec и circle_track
+     */
+    static RouteEvaluator evaluator(uint16_t vec, bool circle_track);
+
+    /**
+     * Окна задач и складов не ограничивают курьера маршрута (см. JobTable::window_free), а маршрут начинается
+     * не раньше смены: ждать не придется, время и расстояние только растут, evaluate идет по короткому пути
+     */
+    static bool window_free(const Route &route);
+
+    /**
+     * Оценка разворота куска first..last (matrix_id его концов) между точками before и after за O(1):
+     * на маршруте без окон с симметричной матрицей без срезов (Route::symmetric) кусок в обе стороны стоит
+     * одинаково, меняются только дуги before -> first и last -> after
+     * Груз подмаршрута тот же; при отрицательных весах промежуточный перевес не виден - ход надо подтвердить
+     * @param state текущая оценка маршрута
+     * @return оценка маршрута с разворотом, если курьер укладывается по смене и расстоянию
+     */
+    static std::optional<State> reversed(const Route &route, const State &state, int before, int first, int last,
+                                         int after);
+
     /**
      * Оценка стоимости подмаршрута, без ожиданий и предыдущих грехов
      * @param track подмаршрут
@@ -84,18 +142,21 @@ public:
     static State get_state_track(const Track &track, const Route &route);
 
     /**
-     * Курьеру хватит умений доставить заказ
+     * Курьеру маршрута хватит умений доставить заказ (биты из таблицы задач, см. SkillSet)
+     * @param job номер заказа в таблице задач маршрута
      */
-    static bool validate_skills(const ptrJob &job, const ptrCourier &courier);
+    static bool validate_skills(uint32_t job, const Route &route);
 
     /**
-     * Курьеру хватит умений работать с этим складом
+     * Курьеру маршрута хватит умений работать с этим складом (биты из таблицы задач)
      */
-    static bool validate_skills(const ptrStorage &storage, const ptrCourier &courier);
+    static bool validate_skills(const ptrStorage &storage, const Route &route);
 
     /**
      * На данный момент маршрут не нарушает ограничений курьера
+     * @tparam Dimension размерность груза (0: из state)
      */
+    template<uint32_t Dimension = 0>
     static bool validate_courier(const State &state, const Route &route);
 
     /**
@@ -104,6 +165,18 @@ public:
     static bool validate_storage(const ptrStorage &storage, const ptrCourier &courier);
 
 private:
+    friend class RouteSegments;  // стоимости перегонов и обслуживания те же, что у оценки маршрута
+
+    /**
+     * Создание маршрута, вариант под Dimension и CircleTrack
+     */
+    template<uint32_t Dimension, bool CircleTrack>
+    static Route build_route(uint16_t vec, ptrCourier &courier, Matrices &matrices, ptrJobTable job_table);
+
+    template<uint32_t Dimension, bool CircleTrack>
+    static std::optional<std::tuple<State, Track>>
+    init_track(int current_point, const State &state, Route &route);
+
     /**
      * Выбор следующей задачи
      * @param location текущая позиция
@@ -112,6 +185,7 @@ private:
      * @param route маршрут
      * @return новое состояние, если найдена задача
      */
+    template<uint32_t Dimension, bool CircleTrack>
     static std::optional<State> choose_job(int location, const State &state, Track &track, Route &route);
 
     /**
@@ -126,18 +200,29 @@ private:
 
     /**
      * Оценка стоимости поездка на заказ
+     * Может ли курьер взять заказ (JobTable::serves), не проверяется: это дело вызывающего, номер курьера у него
      * @param curr_point текущее положение курьера
      * @param state текущее состояние всего тура
-     * @param job заказ
-     * @param storage с какого склада
+     * @param job номер заказа в таблице задач маршрута
      * @param route маршрут
      * @return стоимость без включения предыдущей части
      */
+    template<uint32_t Dimension = 0>
+    static std::optional<State> go_job(int curr_point, const State &state, uint32_t job, const Route &route);
+
+    /**
+     * Оценка стоимости поездки на заказ по уже известному перегону (см. Matrix::get_one_to_many)
+     * @param travel_time время перегона из curr_point (-1: матрица не действует)
+     * @param distance расстояние перегона
+     * @return стоимость без включения предыдущей части
+     */
+    template<uint32_t Dimension = 0>
     static std::optional<State>
-    go_job(int curr_point, const State &state, const ptrJob &job, const ptrStorage &storage, const Route &route);
+    go_job(int curr_point, const State &state, uint32_t job, time_t travel_time, int distance, const Route &route);
 
     /**
      * Оценка стоимости поездки на склад
+     * Может ли курьер заезжать на склад (JobTable::visits), не проверяется, как и в go_job
      * @param curr_point текущее положение курьера
      * @param state текущее состояние тура
      * @param storage склад
@@ -156,6 +241,15 @@ private:
      */
     static float cost(time_t travel_time, int distance, const Route &route);
 
+    /**
+     * Стоимость перегона src -> dst: из общей таблицы маршрута (одна загрузка), если она есть
+     * @param curr_time момент выезда
+     * @param travel_time время перегона из матрицы
+     * @param distance расстояние перегона из матрицы
+     * @return стоимость
+     */
+    static float cost(int src, int dst, time_t curr_time, time_t travel_time, int distance, const Route &route);
+
     /**
      * Сколько секунд придется подождать курьеру, чтобы попасть в ближайшее временное окно
      * @param arrival_time время в туре (arrival + start = current)
@@ -163,7 +257,7 @@ private:
      * @param time_windows временные окна
      * @return ожидание в секундах (-1, если не возможно попасть)
      */
-    static time_t waiting(time_t arrival_time, time_t start_time, const std::vector<Window> &time_windows);
+    static time_t waiting(time_t arrival_time, time_t start_time, std::span<const Window> time_windows);
 
     /**
      * Сколько секунд придется подождать курьеру, чтобы попасть во временное окно
@@ -181,7 +275,21 @@ private:
      * @param route маршрут
      * @return оценка без включения предыдущего
      */
+    template<uint32_t Dimension = 0>
     static std::optional<State> end(int curr_point, const State &state, const Route &route);
 };
 
+// общий вариант оценки собран в problem.cpp, его можно звать напрямую (например, для сравнения)
+extern template std::optional<State> RvrpProblem::evaluate<0, true>(const Route &route);
+
+extern template std::optional<State> RvrpProblem::evaluate<0, false>(const Route &route);
+
+extern template std::optional<State> RvrpProblem::evaluate_windows<0, true>(const Route &route);
+
+extern template std::optional<State> RvrpProblem::evaluate_windows<0, false>(const Route &route);
+
+extern template std::optional<State> RvrpProblem::evaluate_free<0, true>(const Route &route);
+
+extern template std::optional<State> RvrpProblem::evaluate_free<0, false>(const Route &route);
+
 #endif //MADRICH_SOLVER_PROBLEM_H
@@ -1,10 +1,9 @@
 #include "engine.h"
-#include <generators.h>
 
 
-void replace_job(int job_id, Track &track) {
+void replace_job(int job_id, Track &track, const JobTable &table) {
     // replace to unassigned jobs
-    track.storage->unassigned_jobs.push_back(track.jobs[job_id]);
+    track.storage->unassigned_jobs.push_back(table.jobs[track.jobs[job_id]]);
     track.jobs.erase(track.jobs.begin() + job_id);
 }
 
@@ -17,13 +16,13 @@ void MadrichEngine::random_ruin(uint32_t number) {
             if (routes.empty()) {
                 break;  // тогда точно удалять нечего
             }
-            int route_id = generate_number(routes.size());
+            int route_id = random.number(routes.size());
             Route &route = routes[route_id];
             if (route.tracks.empty()) {
                 continue;
             }
 
-            int track_id = generate_number(route.tracks.size());
+            int track_id = random.number(route.tracks.size());
             Track &track = route.tracks[track_id];
             auto size = track.jobs.size();
             if (size == 0) {
@@ -31,7 +30,7 @@ void MadrichEngine::random_ruin(uint32_t number) {
                 continue;
             }
 
-            replace_job(generate_number(size), track);
+            replace_job(random.number(size), track, *job_table);
             mark_route(true, route);
             break;
         }
@@ -46,28 +45,29 @@ void MadrichEngine::random_ruin(uint32_t number) {
         if (routes.empty()) {
             return;  // тогда точно удалять нечего
         }
-        route_id = generate_number(routes.size());
-        track_id = generate_number(routes[route_id].tracks.size());
+        route_id = random.number(routes.size());
+        track_id = random.number(routes[route_id].tracks.size());
         auto size = routes[route_id].tracks[track_id].jobs.size();
         if (size == 0) {
             remove_empty_tracks();  // лучше удалить, вдруг там все пустые
             continue;
         }
-        job_id = generate_number(size);
+        job_id = random.number(size);
         break;
     }
 
-    int matrix_id = routes[route_id].tracks[track_id].jobs[job_id]->location.matrix_id;
+    const JobTable &table = *job_table;
+    int matrix_id = table.location[routes[route_id].tracks[track_id].jobs[job_id]];
     Track &tr = routes[route_id].tracks[track_id];  // не забываем переместить
-    replace_job(job_id, tr);
+    replace_job(job_id, tr, table);
 
     for (auto &route: routes) {
         for (auto &track : route.tracks) {  // перемещаем, а потом удаляем, если попал в радиус
             track.jobs.erase(std::remove_if(track.jobs.begin(), track.jobs.end(),
-                                            [&matrix_id, &track, &route, &radius](const ptrJob &job) {
-                                                int id = job->location.matrix_id;
-                                                if (route.matrix.get_time(matrix_id, id) > radius) {
-                                                    track.storage->unassigned_jobs.push_back(job);
+                                            [&matrix_id, &track, &route, &radius, &table](uint32_t job) {
+                                                int id = table.location[job];
+                                                if (route.matrix->get_time(matrix_id, id, route.start_time) > radius) {
+                                                    track.storage->unassigned_jobs.push_back(table.jobs[job]);
                                                     return true;
                                                 }
                                                 return false;
@@ -0,0 +1,280 @@
+#include "segment.h"
+
+
+ScreenCounters &screen_counters(ScreenOperator op) {
+    thread_local std::array<ScreenCounters, SCREEN_OPERATORS> counters;
+    return counters[std::size_t(op)];
+}
+
+
+bool RouteSegments::usable(const Route &route) {
+    return route.matrix && route.job_table && route.matrix->static_time() &&
+           (route.job_table->max_windows <= 1 || RvrpProblem::window_free(route)) &&
+           std::get<0>(route.courier->work_time.window) <= route.start_time;
+}
+
+bool RouteSegments::bounded(const Route &route) {
+    return route.matrix && route.job_table && route.matrix->static_time();
+}
+
+/**
+ * Ограничения курьера, которые видны без окон: travel_time не меньше duration, расстояние точное
+ */
+bool within_limits(const Route &route, const RouteBound &bound) {
+    int max_distance = route.courier->max_distance;
+    return !bound.overload && (max_distance == 0 || bound.distance <= max_distance) &&
+           route.start_time + bound.duration <= std::get<1>(route.courier->work_time.window);
+}
+
+bool RouteSegments::screen(ScreenCounters &counters, const Route &route, const RouteBound &bound, const State &best) {
+    ++counters.moves;
+    if (bound.duration > best.travel_time) {
+        ++counters.arcs;
+        return false;
+    }
+    if (!within_limits(route, bound)) {
+        ++counters.limits;
+        return false;
+    }
+    ++counters.evaluated;
+    return true;
+}
+
+bool RouteSegments::screen(ScreenCounters &counters, const Route &route1, const RouteBound &bound1,
+                           const Route &route2, const RouteBound &bound2, const State &best) {
+    ++counters.moves;
+    if (bound1.duration + bound2.duration > best.travel_time) {
+        ++counters.arcs;
+        return false;
+    }
+    if (!within_limits(route1, bound1) || !within_limits(route2, bound2)) {
+        ++counters.limits;
+        return false;
+    }
+    ++counters.evaluated;
+    return true;
+}
+
+bool RouteSegments::confirm(const Route &route, const State &current, State &state) {
+    std::optional exact = RvrpProblem::get_state(route);
+    if (!exact || !(exact.value() < current)) {
+        return false;
+    }
+    state = exact.value();
+    return true;
+}
+
+bool RouteSegments::confirm(const Route &route1, const Route &route2, const State &current,
+                            State &state1, State &state2) {
+    std::optional exact1 = RvrpProblem::get_state(route1);
+    std::optional exact2 = RvrpProblem::get_state(route2);
+    if (!exact1 || !exact2 || !(exact1.value() + exact2.value() < current)) {
+        return false;
+    }
+    state1 = exact1.value();
+    state2 = exact2.value();
+    return true;
+}
+
+RouteSegments::RouteSegments(const Route &route)
+        : route(route), courier(route.job_table->index(route.courier)), current(route.job_table->current(courier)) {
+    build();
+}
+
+RouteSegments::RouteSegments(const Route &route, const Track &track)
+        : route(route), courier(route.job_table->index(route.courier)), current(route.job_table->current(courier)) {
+    selected = std::size_t(&track - route.tracks.data());
+    build();
+}
+
+void RouteSegments::build() {
+    std::size_t size = route.tracks.size();
+    std::vector<Segment> tracks(size);
+    for (std::size_t t = 0; t < size; ++t) {
+        tracks[t] = close(track(route.tracks[t]));
+    }
+
+    head.resize(size + 1);
+    tail.resize(size + 1);
+    head[0] = point(route.courier->start_location.matrix_id);
+    for (std::size_t t = 0; t < size; ++t) {
+        head[t + 1] = concat(head[t], tracks[t]);
+    }
+    prefixes.resize(size);
+    suffixes.resize(size);
+    tail[size] = point(route.courier->end_location.matrix_id);
+    for (std::size_t t = size; t > 0; --t) {
+        tail[t - 1] = concat(tracks[t - 1], tail[t]);
+    }
+
+    if (selected < size) {
+        select(selected, route.tracks[selected].jobs);
+    }
+}
+
+void RouteSegments::select(std::size_t track, const JobIds &jobs) {
+    selected = track;
+    const ptrStorage &storage = route.tracks[track].storage;
+    std::vector<Segment> &prefix = prefixes[track];
+    std::vector<Segment> &suffix = suffixes[track];
+    std::size_t size = jobs.size();
+    prefix.resize(size + 1);
+    suffix.resize(size + 1);
+
+    prefix[0] = this->storage(storage);
+    for (std::size_t k = 0; k < size; ++k) {
+        prefix[k + 1] = concat(prefix[k], job(jobs[k]));
+    }
+    suffix[size] = route.circle_track ? this->storage(storage) : Segment();
+    for (std::size_t k = size; k > 0; --k) {
+        suffix[k - 1] = concat(job(jobs[k - 1]), suffix[k]);
+    }
+}
+
+void RouteSegments::select(const Track &track) {
+    select(std::size_t(&track - route.tracks.data()), track.jobs);
+}
+
+void RouteSegments::select_all() {
+    for (std::size_t t = 0; t < route.tracks.size(); ++t) {
+        select(t, route.tracks[t].jobs);
+    }
+}
+
+bool RouteSegments::fits(const Segment &piece) const {
+    const Load &load = prefixes[selected].back().load;  // весь груз подмаршрута
+    for (uint32_t k = 0; k < load.size(); ++k) {
+        if (load[k] + piece.load[k] > route.courier->value[k]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Segment RouteSegments::point(int matrix_id) const {
+    Segment ret;
+    ret.first = ret.last = matrix_id;
+    return ret;
+}
+
+Segment RouteSegments::storage(const ptrStorage &storage) const {
+    const auto &[start_shift, end_shift] = storage->work_time.window;
+    Segment ret = point(storage->location.matrix_id);
+    ret.duration = storage->load;
+    ret.earliest = start_shift - route.start_time - storage->load;
+    ret.latest = end_shift - route.start_time - storage->load;
+    ret.cost = RvrpProblem::cost(storage->load, 0, route);
+    ret.load = ret.peak = Load(route.vec);
+    ret.feasible = route.job_table->visits(courier, route.job_table->index(storage));
+    return ret;
+}
+
+Segment RouteSegments::job(uint32_t job) const {
+    const JobTable &table = *route.job_table;
+    std::span<const Window> windows = table.time_windows(job);
+    Segment ret = point(table.location[job]);
+    ret.jobs = 1;
+    ret.duration = table.delay[job];
+    if (!windows.empty() && !(current && table.window_free(courier, job))) {  // иначе окна не ограничивают
+        const auto &[start_shift, end_shift] = windows[0].window;
+        ret.earliest = start_shift - route.start_time - table.delay[job];
+        ret.latest = end_shift - route.start_time - table.delay[job];
+    }
+    ret.cost = RvrpProblem::cost(table.delay[job], 0, route);
+    ret.load = Load(route.vec);
+    ret.load += table.demand[job];
+    ret.peak = ret.load;
+    // без окон задачу не взять (см. RvrpProblem::waiting)
+    ret.feasible = !windows.empty() && table.serves(courier, job);
+    return ret;
+}
+
+Segment RouteSegments::track(const Track &track) const {
+    if (track.jobs.empty()) {
+        return {};
+    }
+    Segment ret = storage(track.storage);
+    for (uint32_t job : track.jobs) {
+        ret = concat(ret, this->job(job));
+    }
+    return route.circle_track ? concat(ret, storage(track.storage)) : ret;
+}
+
+Segment RouteSegments::concat(const Segment &lhs, const Segment &rhs) const {
+    if (lhs.empty()) {
+        return rhs;
+    }
+    if (rhs.empty()) {
+        return lhs;
+    }
+    auto [tt, d] = route.matrix->get_time_distance(lhs.last, rhs.first, route.start_time);
+    time_t delta = lhs.duration + tt;  // от начала lhs до приезда в rhs без ожиданий
+
+    Segment ret = lhs;
+    ret.last = rhs.last;
+    ret.jobs += rhs.jobs;
+    ret.duration = delta + rhs.duration;
+    ret.earliest = std::max(lhs.earliest, rhs.earliest - delta);
+    ret.latest = std::min(lhs.latest, rhs.latest - delta);
+    ret.distance += d + rhs.distance;
+    ret.cost += RvrpProblem::cost(lhs.last, rhs.first, route.start_time, tt, d, route) + rhs.cost;
+    for (uint32_t k = 0; k < ret.load.size(); ++k) {
+        ret.peak[k] = std::max(lhs.peak[k], lhs.load[k] + rhs.peak[k]);
+        ret.load[k] += rhs.load[k];
+    }
+    // даже выехав из lhs как можно раньше, в окно rhs уже не успеть
+    ret.feasible = lhs.feasible && rhs.feasible && lhs.earliest + delta <= rhs.latest;
+    return ret;
+}
+
+Segment RouteSegments::close(Segment track) const {
+    for (uint32_t k = 0; k < track.peak.size(); ++k) {
+        if (track.peak[k] > route.courier->value[k]) {
+            track.feasible = false;
+        }
+    }
+    track.load = track.peak = Load();
+    return track;
+}
+
+std::optional<State> RouteSegments::state(const Segment &track) const {
+    if (track.jobs == 0) {  // пустой подмаршрут пропускается целиком, как в RvrpProblem::evaluate
+        return finish(concat(head[selected], tail[selected + 1]));
+    }
+    return finish(concat(concat(head[selected], close(track)), tail[selected + 1]));
+}
+
+std::optional<State> RouteSegments::replaced(uint32_t from, uint32_t to, const Segment &piece) const {
+    return state(concat(concat(prefix(from), piece), suffix(to)));
+}
+
+std::optional<State> RouteSegments::inserted(std::size_t position, const Segment &track) const {
+    return finish(concat(concat(head[position], close(track)), tail[position]));
+}
+
+RouteBound RouteSegments::bound(uint32_t from, uint32_t to, const Segment &piece) const {
+    Segment track = concat(concat(prefix(from), piece), suffix(to));
+    RouteBound ret;
+    for (uint32_t k = 0; k < track.peak.size(); ++k) {
+        ret.overload = ret.overload || track.peak[k] > route.courier->value[k];
+    }
+    // пустой подмаршрут пропускается целиком, как в state
+    Segment whole = track.jobs == 0 ? concat(head[selected], tail[selected + 1])
+                                    : concat(concat(head[selected], close(track)), tail[selected + 1]);
+    ret.duration = whole.duration;
+    ret.distance = whole.distance;
+    return ret;
+}
+
+std::optional<State> RouteSegments::finish(const Segment &segment) const {
+    if (!segment.feasible || segment.latest < 0) {
+        return std::nullopt;
+    }
+    time_t waiting = std::max<time_t>(0, segment.earliest);  // все ожидания маршрута, выезд в момент 0
+    State ret(waiting + segment.duration, segment.distance, segment.cost + RvrpProblem::cost(waiting, 0, route));
+    // время и расстояние только растут: проверки курьера по пути сводятся к проверке в конце
+    if (!RvrpProblem::validate_courier(ret, route)) {
+        return std::nullopt;
+    }
+    return ret;
+}
@@ -0,0 +1,271 @@
+#ifndef MADRICH_SOLVER_SEGMENT_H
+#define MADRICH_SOLVER_SEGMENT_H
+
+#include <base_model.h>
+#include <local_search/problem.h>
+
+
+/**
+ * Оценка ходов склейкой кусков маршрута (как в Vidal et al., но с жесткими окнами, без нарушений)
+ * Кусок - подряд идущие посещения (точки, склады, задачи) со сводкой: чистое время, расстояние, стоимость
+ * без ожиданий, груз, и самый ранний и самый поздний момент начала куска. Начали в момент t <= latest -
+ * закончили в max(t, earliest) + duration, ожидания внутри куска - max(0, earliest - t). Склейка двух кусков
+ * с перегоном между ними - O(1), так что ход, который собирается из нескольких кусков, оценивается без прохода
+ * по всему маршруту. Окно посещения относится к концу обслуживания, как в RvrpProblem::go_job: подождать
+ * до окна можно и до, и после обслуживания, момент выезда один и тот же
+ *
+ * Работает, только если время перегона не зависит от момента выезда (Matrix::static_time) и у каждой задачи
+ * не больше одного окна (или окна вообще не ограничивают курьера, см. RvrpProblem::window_free);
+ * иначе ходы оцениваются RvrpProblem::get_state (см. RouteSegments::usable)
+ *
+ * Без срезов матрицы длительность, расстояние и груз куска от окон не зависят: если окон у задач несколько,
+ * склейка все равно дает нижнюю границу хода, и get_state зовется только для ходов, которые ее прошли
+ * (см. RouteSegments::bound, RouteSegments::screen)
+ */
+
+
+/**
+ * "Нет границы" для earliest/latest: с запасом, чтобы вычитание длительностей не переполнялось
+ */
+constexpr time_t SEGMENT_EARLY = std::numeric_limits<time_t>::min() / 4;
+constexpr time_t SEGMENT_LATE = std::numeric_limits<time_t>::max() / 4;
+
+
+/**
+ * Сводка куска маршрута; время - от начала маршрута (Route::start_time)
+ * Пустой кусок (first == -1) нейтрален при склейке
+ */
+class Segment {
+public:
+    int first = -1;  // matrix_id первой точки
+    int last = -1;  // matrix_id последней точки
+    uint32_t jobs = 0;  // задач в куске
+    time_t duration = 0;  // переезды и обслуживание, без ожиданий
+    time_t earliest = SEGMENT_EARLY;  // начинать раньше нет смысла: все равно ждать до окна
+    time_t latest = SEGMENT_LATE;  // начать позже - опоздать в окно
+    int distance = 0;  // расстояние
+    float cost = 0;  // стоимость переездов и обслуживания, без ожиданий
+    Load load;  // груз подмаршрута (у закрытого подмаршрута и точек маршрута - пустой)
+    Load peak;  // наибольший груз на префиксах куска: его и проверяет вместимость
+    bool feasible = true;  // окна, склады и умения куска выполнимы
+
+    [[nodiscard]] bool empty() const { return first == -1; }
+};
+
+
+/**
+ * Нижняя граница маршрута с ходом (см. RouteSegments::bound)
+ */
+class RouteBound {
+public:
+    time_t duration = 0;  // переезды и обслуживание без ожиданий: travel_time не меньше
+    int distance = 0;  // расстояние, точно
+    bool overload = false;  // у измененного подмаршрута перевес (по peak)
+};
+
+
+/**
+ * Счетчики ступеней отсева ходов одного оператора (см. RouteSegments::screen)
+ */
+class ScreenCounters {
+public:
+    uint64_t moves = 0;  // ходов дошло до отсева
+    uint64_t arcs = 0;  // отсеяно по дугам: даже без ожиданий не лучше
+    uint64_t limits = 0;  // отсеяно по вместимости, максимальному расстоянию и концу смены
+    uint64_t evaluated = 0;  // оценено целиком (get_state, с окнами)
+};
+
+
+/**
+ * Операторы с отсевом ходов
+ */
+enum class ScreenOperator : uint8_t {
+    TwoOpt,
+    ThreeOpt,
+    Swap,
+    Cross,
+};
+
+constexpr std::size_t SCREEN_OPERATORS = 4;
+
+/**
+ * Счетчики оператора, свои на поток; накапливаются, пока их не обнулят
+ */
+ScreenCounters &screen_counters(ScreenOperator op);
+
+
+/**
+ * Куски одного маршрута: head/tail по подмаршрутам (начало маршрута и все до подмаршрута, все после и конец)
+ * и prefix/suffix по задачам выбранного подмаршрута (склад и первые k задач, задачи с k и возврат на склад).
+ * Ход в выбранном подмаршруте - head ⊕ prefix ⊕ (новые куски) ⊕ suffix ⊕ tail, каждая склейка O(1)
+ * Массивы пересчитываются (build, select), только когда маршрут действительно меняется
+ * prefix/suffix хранятся по каждому подмаршруту: после select_all вставка в любое место любого подмаршрута
+ * проверяется за O(1) (pick только переключает подмаршрут)
+ * Хранит ссылку на маршрут: маршрут должен жить дольше, другие подмаршруты во время оценки не меняются
+ */
+class RouteSegments {
+public:
+    /**
+     * Можно ли оценивать маршрут склейкой: матрица без срезов и срока, у задач не больше одного окна (или окна
+     * не ограничивают), смена курьера началась к началу маршрута (тогда проверки курьера монотонны
+     * и хватает проверки в конце)
+     */
+    static bool usable(const Route &route);
+
+    /**
+     * Годится ли склейка хотя бы для нижней границы (bound): матрица без срезов, окна любые
+     */
+    static bool bounded(const Route &route);
+
+    /**
+     * Отсев хода в одном маршруте перед get_state, по ступеням: по дугам (bound.duration больше best - ход
+     * не лучше, State сравнивается сначала по travel_time), затем ограничения курьера (перевес, максимальное
+     * расстояние, конец смены). Отсеянный ход get_state не оценил бы лучше best
+     * @param best лучшая оценка маршрута на сейчас
+     * @return нужна ли полная оценка
+     */
+    static bool screen(ScreenCounters &counters, const Route &route, const RouteBound &bound, const State &best);
+
+    /**
+     * То же для хода между двумя маршрутами: по дугам сравнивается сумма, ограничения - у каждого
+     */
+    static bool screen(ScreenCounters &counters, const Route &route1, const RouteBound &bound1,
+                       const Route &route2, const RouteBound &bound2, const State &best);
+
+    /**
+     * Ход выбран по склейке, а она складывает стоимость float в другом порядке, чем get_state:
+     * ход уже записан в маршрут, берем его, только если точная оценка лучше current
+     * (иначе на ходах без выигрыша можно ходить по кругу из-за округления)
+     * @param state точная оценка маршрута с ходом
+     */
+    static bool confirm(const Route &route, const State &current, State &state);
+
+    /**
+     * То же для хода между двумя маршрутами: сравнивается сумма оценок
+     */
+    static bool confirm(const Route &route1, const Route &route2, const State &current, State &state1, State &state2);
+
+    /**
+     * head/tail по текущим подмаршрутам, выбран первый подмаршрут (если он есть)
+     */
+    explicit RouteSegments(const Route &route);
+
+    /**
+     * head/tail и prefix/suffix выбранного track; track - подмаршрут из route.tracks
+     */
+    explicit RouteSegments(const Route &route, const Track &track);
+
+    /**
+     * Пересчет head/tail после изменения маршрута, выбранный подмаршрут пересчитывается по route.tracks
+     */
+    void build();
+
+    /**
+     * Выбор подмаршрута: prefix/suffix по jobs (задачи могут быть еще не записаны в маршрут)
+     * @param track номер подмаршрута в route.tracks
+     * @param jobs задачи подмаршрута
+     */
+    void select(std::size_t track, const JobIds &jobs);
+
+    /**
+     * Выбор подмаршрута по его задачам в маршруте; track - подмаршрут из route.tracks
+     */
+    void select(const Track &track);
+
+    /**
+     * prefix/suffix по задачам маршрута сразу для всех подмаршрутов
+     */
+    void select_all();
+
+    /**
+     * Выбор подмаршрута без пересчета: prefix/suffix уже посчитаны (select или select_all)
+     * @param track номер подмаршрута в route.tracks
+     */
+    void pick(std::size_t track) { selected = track; }
+
+    /**
+     * Склад выбранного подмаршрута и первые k его задач
+     */
+    [[nodiscard]] const Segment &prefix(uint32_t k) const { return prefixes[selected][k]; }
+
+    /**
+     * Задачи выбранного подмаршрута с k-й и возврат на склад (если он обязателен)
+     */
+    [[nodiscard]] const Segment &suffix(uint32_t k) const { return suffixes[selected][k]; }
+
+    /**
+     * Помещается ли груз выбранного подмаршрута вместе с грузом piece, за O(1) по накопленному грузу
+     */
+    [[nodiscard]] bool fits(const Segment &piece) const;
+
+    /**
+     * Кусок из одной задачи для курьера этого маршрута
+     * @param job номер задачи в таблице задач
+     */
+    [[nodiscard]] Segment job(uint32_t job) const;
+
+    /**
+     * Весь подмаршрут: склад, задачи, возврат (если обязателен); без задач - пустой кусок
+     */
+    [[nodiscard]] Segment track(const Track &track) const;
+
+    /**
+     * Склейка lhs ⊕ rhs через перегон lhs.last -> rhs.first
+     */
+    [[nodiscard]] Segment concat(const Segment &lhs, const Segment &rhs) const;
+
+    /**
+     * Оценка маршрута, где выбранный подмаршрут заменен на track (склад, задачи и возврат, см. prefix/suffix)
+     * @return как у RvrpProblem::get_state, стоимость - с точностью до порядка сложения float
+     */
+    [[nodiscard]] std::optional<State> state(const Segment &track) const;
+
+    /**
+     * Оценка маршрута, где задачи [from, to) выбранного подмаршрута заменены на piece:
+     * prefix(from) ⊕ piece ⊕ suffix(to)
+     */
+    [[nodiscard]] std::optional<State> replaced(uint32_t from, uint32_t to, const Segment &piece) const;
+
+    /**
+     * Оценка маршрута с новым подмаршрутом track перед подмаршрутом position (position = size: в конец)
+     */
+    [[nodiscard]] std::optional<State> inserted(std::size_t position, const Segment &track) const;
+
+    /**
+     * Нижняя граница маршрута, где задачи [from, to) выбранного подмаршрута заменены на piece;
+     * окна не смотрятся, так что годится для любого bounded маршрута
+     */
+    [[nodiscard]] RouteBound bound(uint32_t from, uint32_t to, const Segment &piece) const;
+
+private:
+    const Route &route;
+    uint32_t courier;  // номер курьера маршрута в таблице задач
+    bool current;  // биты окон курьера в таблице не устарели (JobTable::current)
+    std::vector<Segment> head;  // head[t]: начало маршрута и подмаршруты до t
+    std::vector<Segment> tail;  // tail[t]: подмаршруты с t и конечная точка
+    std::size_t selected = 0;  // выбранный подмаршрут
+    std::vector<std::vector<Segment>> prefixes;  // prefixes[t][k]: склад и первые k задач подмаршрута t
+    std::vector<std::vector<Segment>> suffixes;  // suffixes[t][k]: задачи с k и возврат
+
+    /**
+     * Точка без обслуживания и окон (начало или конец маршрута)
+     */
+    [[nodiscard]] Segment point(int matrix_id) const;
+
+    /**
+     * Заезд на склад: перезагрузка и окно работы склада
+     */
+    [[nodiscard]] Segment storage(const ptrStorage &storage) const;
+
+    /**
+     * Подмаршрут закончен: проверка вместимости по peak, груз дальше не переносится
+     */
+    [[nodiscard]] Segment close(Segment track) const;
+
+    /**
+     * Маршрут целиком (начало ⊕ ... ⊕ конец) в состояние, с проверками курьера
+     */
+    [[nodiscard]] std::optional<State> finish(const Segment &segment) const;
+};
+
+#endif //MADRICH_SOLVER_SEGMENT_H
@@ -16,6 +16,9 @@ PYBIND11_MODULE(base_model, m) {
             .def("print", &Window::print)
             .def_readwrite("window", &Window::window);
 
+    m.def("parse_time", &parse_time);
+    m.def("parse_windows", &parse_windows);
+
     py::class_<Point>(m, "Point")
             .def(py::init<>())
             .def(py::init<const Point &>())
@@ -33,20 +36,71 @@ PYBIND11_MODULE(base_model, m) {
             .def_readwrite("second", &Cost::second)
             .def_readwrite("meter", &Cost::meter);
 
+    py::enum_<MatrixLayout>(m, "MatrixLayout")
+            .value("Flat", MatrixLayout::Flat)
+            .value("Quantized", MatrixLayout::Quantized)
+            .value("Interleaved", MatrixLayout::Interleaved)
+            .value("Symmetric", MatrixLayout::Symmetric);
+
     py::class_<Matrix>(m, "Matrix")
             .def(py::init<>())
             .def(py::init<const Matrix &>())
-            .def(py::init<std::string, std::vector<std::vector<int>>, std::vector<std::vector<time_t>>>())
-            .def(py::init<std::string, std::vector<std::vector<std::vector<int>>>, std::vector<std::vector<std::vector<time_t>>>, uint32_t, time_t, time_t>())
+            .def(py::init<const Matrix &, MatrixLayout, bool>(),
+                 py::arg("matrix"),
+                 py::arg("layout"),
+                 py::arg("interpolation") = false
+            )
+            .def(py::init<std::string, const std::vector<std::vector<int>> &, const std::vector<std::vector<time_t>> &, MatrixLayout>(),
+                 py::arg("profile"),
+                 py::arg("distance"),
+                 py::arg("travel_time"),
+                 py::arg("layout") = MatrixLayout::Flat
+            )
+            .def(py::init<std::string, const std::vector<std::vector<std::vector<int>>> &, const std::vector<std::vector<std::vector<time_t>>> &, uint32_t, time_t, time_t, MatrixLayout, bool>(),
+                 py::arg("profile"),
+                 py::arg("distance"),
+                 py::arg("travel_time"),
+                 py::arg("discreteness"),
+                 py::arg("start_time"),
+                 py::arg("end_time"),
+                 py::arg("layout") = MatrixLayout::Flat,
+                 py::arg("interpolation") = false
+            )
+            .def(py::init<const std::string &>())
+            .def("save", &Matrix::save)
+            .def("memory_usage", &Matrix::memory_usage)
             .def("print", &Matrix::print)
             .def_readwrite("profile", &Matrix::profile)
+            .def("dimension", &Matrix::dimension)
+            .def("slices", &Matrix::slices)
+            .def("get_layout", &Matrix::get_layout)
+            .def("interpolated", &Matrix::interpolated)
+            .def("symmetric", &Matrix::symmetric)
             .def("get_distance", &Matrix::get_distance)
-            .def("get_time", &Matrix::get_time);
+            .def("get_time", &Matrix::get_time)
+            .def("get_time_distance", &Matrix::get_time_distance)
+            .def("get_one_to_many", [](const Matrix &matrix, uint32_t src, const std::vector<uint32_t> &dst,
+                                       time_t curr_time) {
+                     std::vector<time_t> times(dst.size());
+                     std::vector<int> distances(dst.size());
+                     matrix.get_one_to_many(src, dst, times, distances, curr_time);
+                     return std::make_tuple(times, distances);
+                 },
+                 py::arg("src"),
+                 py::arg("dst"),
+                 py::arg("curr_time") = 0);
 
     py::class_<State>(m, "State")
             .def(py::init<>())
             .def(py::init<const State &>())
-            .def(py::init<time_t, int, float, std::optional<std::vector<int>>>())
+            .def(py::init([](time_t travel_time, int distance, float cost, std::optional<std::vector<int>> value) {
+                     return State(travel_time, distance, cost,
+                                  value ? std::optional<Load>(Load(value.value())) : std::nullopt);
+                 }),
+                 py::arg("travel_time"),
+                 py::arg("distance"),
+                 py::arg("cost"),
+                 py::arg("value") = std::nullopt)
             .def("__add__", &State::operator+, py::is_operator())
             .def("__iadd__", &State::operator+=, py::is_operator())
             .def("__sub__", &State::operator-, py::is_operator())
@@ -56,8 +110,15 @@ PYBIND11_MODULE(base_model, m) {
             .def_readwrite("travel_time", &State::travel_time)
             .def_readwrite("distance", &State::distance)
             .def_readwrite("cost", &State::cost)
-            .def_readwrite("value", &State::value);
+            .def_property("value",
+                          [](const State &state) {
+                              return state.value ? std::optional(state.value->to_vector()) : std::nullopt;
+                          },
+                          [](State &state, const std::optional<std::vector<int>> &value) {
+                              state.value = value ? std::optional<Load>(Load(value.value())) : std::nullopt;
+                          });
 
+    // поля задачи копируются в таблицу задач при добавлении: задачу, уже отданную движку или маршруту, не меняют
     py::class_<Job>(m, "Job")
             .def(py::init<>())
             .def(py::init<const Job &>())
@@ -108,7 +169,7 @@ PYBIND11_MODULE(base_model, m) {
             .def_readwrite("value", &Courier::value)
             .def_readwrite("skills", &Courier::skills)
             .def_readwrite("max_distance", &Courier::max_distance)
-            .def_readwrite("work_time", &Courier::work_time)
+            .def_readwrite("work_time", &Courier::work_time)  // новую смену таблицы задач учтут после JobTable.refresh
             .def_readwrite("start_location", &Courier::start_location)
             .def_readwrite("end_location", &Courier::end_location)
             .def_readwrite("storages", &Courier::storages);
@@ -118,19 +179,76 @@ PYBIND11_MODULE(base_model, m) {
             .def(py::init<ptrStorage>())
             .def("print", &Track::print)
             .def_readwrite("storage", &Track::storage)
-            .def_readwrite("jobs", &Track::jobs);
+            .def_readwrite("jobs", &Track::jobs);  // номера задач, сами задачи - Route.track_jobs
+
+    // таблица задач тура: номера задач, складов и курьеров - свои в каждой таблице, треки хранят номера,
+    // так что маршруты одного тура должны разделять одну таблицу (например, MadrichEngine.job_table)
+    py::class_<JobTable, shared_ptr<JobTable>>(m, "JobTable")
+            .def(py::init<>())
+            .def(py::init<const Storages &>())
+            .def("index", py::overload_cast<const ptrJob &>(&JobTable::index, py::const_))
+            .def("index", py::overload_cast<const ptrStorage &>(&JobTable::index, py::const_))
+            .def("index", py::overload_cast<const ptrCourier &>(&JobTable::index, py::const_))
+            .def("contains", py::overload_cast<const ptrJob &>(&JobTable::contains, py::const_))
+            .def("contains", py::overload_cast<const ptrStorage &>(&JobTable::contains, py::const_))
+            .def("contains", py::overload_cast<const ptrCourier &>(&JobTable::contains, py::const_))
+            .def("refresh", &JobTable::refresh)
+            .def("size", &JobTable::size);
 
     py::class_<Route>(m, "Route")
             .def(py::init<>())
-            .def(py::init<uint16_t, time_t, bool, ptrCourier, const Matrix &>())
+            .def(py::init([](uint16_t vec, time_t start_time, bool circle_track, ptrCourier courier, const Matrix &matrix,
+                             shared_ptr<JobTable> job_table) {
+                if (!job_table) {  // своя таблица: только для маршрута без движка
+                    job_table = std::make_shared<JobTable>();
+                }
+                job_table->add_with_jobs(courier);  // задачи складов курьера
+                Route route(vec, start_time, circle_track, std::move(courier), std::make_shared<const Matrix>(matrix),
+                            std::move(job_table));
+                route.symmetric = matrix.static_time() && matrix.symmetric();
+                return route;
+            }),
+                 py::arg("vec"), py::arg("start_time"), py::arg("circle_track"), py::arg("courier"), py::arg("matrix"),
+                 py::arg("job_table") = nullptr)
             .def("assigned_jobs", &Route::assigned_jobs)
             .def("unassigned_jobs", &Route::unassigned_jobs)
+            .def("track_jobs", &Route::track_jobs)
             .def("print", &Route::print)
-            .def_readwrite("vec", &Route::vec)
-            .def_readwrite("courier", &Route::courier)
-            .def_readwrite("matrix", &Route::matrix)
+            .def_property("vec",  // оценка была выбрана под размерность, выбираем заново
+                          [](const Route &route) { return route.vec; },
+                          [](Route &route, uint16_t vec) {
+                              route.vec = vec;
+                              route.evaluator = nullptr;
+                          })
+            .def_property("courier",  // тариф мог смениться, таблицу стоимостей сбрасываем
+                          [](const Route &route) { return route.courier; },
+                          [](Route &route, ptrCourier courier) {
+                              // номер, умения и совместимость курьера - из таблицы маршрута, как в конструкторе
+                              // (таблицы маршрутов собираются изменяемыми, константны только для оценки)
+                              auto table = std::const_pointer_cast<JobTable>(route.job_table);
+                              if (!table) {
+                                  table = std::make_shared<JobTable>();
+                              }
+                              table->add_with_jobs(courier);
+                              route.job_table = table;
+                              route.courier = std::move(courier);
+                              route.costs = nullptr;
+                          })
+            .def_property("matrix",  // разворот за O(1) (RvrpProblem::reversed) - только по симметричной без срезов
+                          [](const Route &route) { return *route.matrix; },
+                          [](Route &route, const Matrix &matrix) {
+                              route.matrix = std::make_shared<const Matrix>(matrix);
+                              route.costs = nullptr;
+                              route.symmetric = matrix.static_time() && matrix.symmetric();
+                          })
             .def_readwrite("start_time", &Route::start_time)
             .def_readwrite("state", &Route::state)
-            .def_readwrite("circle_track", &Route::circle_track)
+            .def_property("circle_track",  // и под возврат на склад
+                          [](const Route &route) { return route.circle_track; },
+                          [](Route &route, bool circle_track) {
+                              route.circle_track = circle_track;
+                              route.evaluator = nullptr;
+                          })
+            .def_readonly("symmetric", &Route::symmetric)  // следует за матрицей
             .def_readwrite("tracks", &Route::tracks);
 };
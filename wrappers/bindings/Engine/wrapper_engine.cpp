@@ -11,6 +11,7 @@
 #include "improve_tour.cpp"
 #include "route_utils.cpp"
 #include "problem.cpp"
+#include "segment.cpp"
 #include "intra_operators.cpp"
 #include "inter_operators.cpp"
 
@@ -20,7 +21,14 @@ PYBIND11_MODULE(rvrp_model, m) {
     py::class_<MadrichEngine>(m, "MadrichEngine")
             .def(py::init<>())
             .def("build_tour", &MadrichEngine::build_tour)
-            .def("improve", &MadrichEngine::improve)
+            .def("improve", &MadrichEngine::improve,
+                 py::arg("work_time") = 0,
+                 py::arg("max_fails") = 5,
+                 py::arg("phases") = 0,
+                 py::arg("post_three_opt") = false,
+                 py::arg("post_cross") = false,
+                 py::arg("neighbors") = 0,
+                 py::arg("neighbor_windows") = false)
             .def("get_state", &MadrichEngine::get_state)
             .def("add_job", &MadrichEngine::add_job)
             .def("add_jobs", &MadrichEngine::add_jobs)
@@ -29,6 +37,31 @@ PYBIND11_MODULE(rvrp_model, m) {
             .def("unassigned_jobs", &MadrichEngine::unassigned_jobs)
             .def("assigned_jobs", &MadrichEngine::assigned_jobs)
             .def("print", &MadrichEngine::print)
+            .def("memory_report", &MadrichEngine::memory_report)
+            .def("cache_costs", &MadrichEngine::cache_costs)
+            .def("cache_states", &MadrichEngine::cache_states, py::arg("capacity") = 1 << 16)
+            .def("cache_report", &MadrichEngine::cache_report)
+            .def_static("screen_report", &MadrichEngine::screen_report, py::arg("reset") = false)
+            .def("seed", &MadrichEngine::seed, py::arg("seed"))
             .def_readwrite("storages", &MadrichEngine::storages)
-            .def_readwrite("routes", &MadrichEngine::routes);
+            .def_property_readonly("job_table", [](const MadrichEngine &engine) { return engine.job_table; })
+            .def_property("routes",  // номера задач и умения курьеров - по таблице движка
+                          [](const MadrichEngine &engine) { return engine.routes; },
+                          [](MadrichEngine &engine, std::vector<Route> routes) {
+                              JobTable &table = *engine.job_table;
+                              for (auto &route : routes) {
+                                  if (route.courier) {
+                                      table.add(route.courier);
+                                  }
+                                  if (route.job_table && route.job_table != engine.job_table) {
+                                      for (auto &track : route.tracks) {  // номера из таблицы маршрута - в номера движка
+                                          for (uint32_t &job : track.jobs) {
+                                              job = table.add(route.job_table->jobs[job], track.storage);
+                                          }
+                                      }
+                                  }
+                                  route.job_table = engine.job_table;
+                              }
+                              engine.routes = std::move(routes);
+                          });
 };
@@ -7,11 +7,79 @@
 namespace py = pybind11;
 
 PYBIND11_MODULE(generators, m) {
-    m.def("generate_value", &generate_value);
-    m.def("generate_tuple", &generate_tuple);
-    m.def("generate_points", &generate_points);
+    m.def("generate_seed", &generate_seed, py::arg("seed"));
+    m.def("generate_value", []() { return generate_value(); });
+    m.def("generate_tuple", []() { return generate_tuple(); });
+    m.def("generate_points", [](int n, float min_x, float max_x, float min_y, float max_y) {
+              return generate_points(n, min_x, max_x, min_y, max_y);
+          },
+          py::arg("n"),
+          py::arg("min_x") = 55.65,
+          py::arg("max_x") = 55.82,
+          py::arg("min_y") = 37.45,
+          py::arg("max_y") = 37.75);
     m.def("generate_distance", &generate_distance);
     m.def("generate_time", &generate_time);
+    m.def("generate_matrix", &generate_matrix,
+          py::arg("profile"),
+          py::arg("points"),
+          py::arg("layout") = MatrixLayout::Flat,
+          py::arg("threads") = 0,
+          py::arg("speed") = 10);
+
+    py::class_<TrafficConfig>(m, "TrafficConfig")
+            .def(py::init<>())
+            .def_readwrite("slices", &TrafficConfig::slices)
+            .def_readwrite("discreteness", &TrafficConfig::discreteness)
+            .def_readwrite("start_time", &TrafficConfig::start_time)
+            .def_readwrite("morning_peak", &TrafficConfig::morning_peak)
+            .def_readwrite("morning_hour", &TrafficConfig::morning_hour)
+            .def_readwrite("evening_peak", &TrafficConfig::evening_peak)
+            .def_readwrite("evening_hour", &TrafficConfig::evening_hour)
+            .def_readwrite("peak_width", &TrafficConfig::peak_width)
+            .def_readwrite("spread", &TrafficConfig::spread)
+            .def_readwrite("speed", &TrafficConfig::speed)
+            .def_readwrite("layout", &TrafficConfig::layout)
+            .def_readwrite("interpolation", &TrafficConfig::interpolation)
+            .def_readwrite("threads", &TrafficConfig::threads)
+            .def_readwrite("seed", &TrafficConfig::seed);
+
+    m.def("generate_traffic_matrix", &generate_traffic_matrix,
+          py::arg("profile"),
+          py::arg("points"),
+          py::arg("config") = TrafficConfig());
     m.def("generate_jobs", &generate_jobs);
-    m.def("generate_rvrp", &generate_rvrp);
+    m.def("generate_rvrp", &generate_rvrp,
+          py::arg("jobs"),
+          py::arg("storages"),
+          py::arg("couriers"),
+          py::arg("seed") = std::nullopt);
+
+    py::enum_<PointsFamily>(m, "PointsFamily")
+            .value("Random", PointsFamily::Random)
+            .value("Clustered", PointsFamily::Clustered)
+            .value("Mixed", PointsFamily::Mixed);
+
+    py::class_<InstanceProfile>(m, "InstanceProfile")
+            .def(py::init<std::string, double>(), py::arg("name"), py::arg("speed") = 10)
+            .def_readwrite("name", &InstanceProfile::name)
+            .def_readwrite("speed", &InstanceProfile::speed);
+
+    py::class_<InstanceConfig>(m, "InstanceConfig")
+            .def(py::init<>())
+            .def_readwrite("jobs", &InstanceConfig::jobs)
+            .def_readwrite("storages", &InstanceConfig::storages)
+            .def_readwrite("couriers", &InstanceConfig::couriers)
+            .def_readwrite("locations", &InstanceConfig::locations)
+            .def_readwrite("points", &InstanceConfig::points)
+            .def_readwrite("clusters", &InstanceConfig::clusters)
+            .def_readwrite("cluster_sigma", &InstanceConfig::cluster_sigma)
+            .def_readwrite("tight_windows", &InstanceConfig::tight_windows)
+            .def_readwrite("window_free", &InstanceConfig::window_free)
+            .def_readwrite("heterogeneous", &InstanceConfig::heterogeneous)
+            .def_readwrite("profiles", &InstanceConfig::profiles)
+            .def_readwrite("layout", &InstanceConfig::layout)
+            .def_readwrite("seed", &InstanceConfig::seed);
+
+    m.def("generate_instance", &generate_instance, py::arg("config"));
 };
@@ -8,6 +8,7 @@
 #include "improve_tour.cpp"
 #include "route_utils.cpp"
 #include "problem.cpp"
+#include "segment.cpp"
 #include "intra_operators.cpp"
 #include "inter_operators.cpp"
 #include "hvrp_main.cpp"
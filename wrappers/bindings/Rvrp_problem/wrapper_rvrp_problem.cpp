@@ -13,8 +13,18 @@ PYBIND11_MODULE(rvrp_problem, m) {
     py::class_<RvrpProblem>(m, "RvrpProblem")
             .def(py::init<>())
             .def("init_tour", &RvrpProblem::init_tour)
-            .def("init_route", &RvrpProblem::init_route)
-            .def("init_track", &RvrpProblem::init_track)
+            .def_static("init_route", [](uint16_t vec, ptrCourier &courier, std::map<std::string, Matrix> &matrices,
+                                         bool circle_track, shared_ptr<JobTable> job_table) {
+                Matrices shared = share_matrices(matrices, {courier});
+                if (!job_table) {  // своя таблица: только для маршрута без движка (см. base_model.JobTable)
+                    job_table = std::make_shared<JobTable>();
+                }
+                job_table->add_with_jobs(courier);  // задачи складов курьера
+                return RvrpProblem::init_route(vec, courier, shared, circle_track, job_table);
+            }, py::arg("vec"), py::arg("courier"), py::arg("matrices"), py::arg("circle_track"),
+               py::arg("job_table") = nullptr)
+            .def("init_track", static_cast<std::optional<std::tuple<State, Track>> (*)(int, const State &, Route &)>(
+                    &RvrpProblem::init_track))
             .def("get_state", &RvrpProblem::get_state)
             .def("get_state_track", &RvrpProblem::get_state_track);
 };